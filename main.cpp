@@ -11,10 +11,54 @@
 #include <array>
 #include <limits> // bulletproof against input garbage
 #include <cstdlib>  // for std::system
+#include <csignal>
+#include <optional>
 #include <string_view>
 #include <sstream>
+#include <fstream>
 #include <stdexcept>
 #include <utility>
+#include <charconv> // allocation-free number formatting/parsing
+#include <cstdint>
+#include <cerrno>
+#include <cstring> // memchr - vectorised byte scanning in every libc
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <shared_mutex>
+#include <span>
+#include <type_traits>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <tuple>
+#include <filesystem>
+#include <list>
+#include <fcntl.h> // open() flags for exports
+#if defined(__x86_64__) || defined(__i386__)
+    #include <x86intrin.h> // __rdtsc for trace timestamps
+#elif defined(_M_X64)
+    #include <intrin.h>
+#endif
+#ifdef _WIN32
+    #include <io.h>
+#else
+    #include <unistd.h>
+    #include <sys/mman.h> // mmap for archive imports
+    #include <sys/stat.h>
+    #include <sys/socket.h> // replication links
+    #include <sys/un.h>
+    #include <netinet/in.h>
+    #include <netinet/tcp.h>
+    #include <arpa/inet.h>
+    #include <poll.h>
+    #include <sys/uio.h> // writev for parallel exports
+#endif
 
 
 constexpr int TOTAL_QUARTERS = 4;
@@ -31,6 +75,33 @@ constexpr std::string_view cardName(CardType type) noexcept {
     return "Unknown";
 }
 
+// What happened - lets exporters and tools work without parsing descriptions
+enum class EventKind : unsigned char { QuarterStart = 0, QuarterEnd, Goal, Card, PenaltyCorner, Count };
+
+constexpr std::string_view eventKindName(EventKind kind) noexcept {
+    switch (kind) {
+        case EventKind::QuarterStart:  return "quarter_start";
+        case EventKind::QuarterEnd:    return "quarter_end";
+        case EventKind::Goal:          return "goal";
+        case EventKind::Card:          return "card";
+        case EventKind::PenaltyCorner: return "penalty_corner";
+        case EventKind::Count:         break;
+    }
+    return "unknown";
+}
+
+// Which team an event belongs to (None for quarter markers)
+enum class Side : unsigned char { None = 0, Home, Away };
+
+constexpr std::string_view sideName(Side side) noexcept {
+    switch (side) {
+        case Side::None: return "";
+        case Side::Home: return "home";
+        case Side::Away: return "away";
+    }
+    return "";
+}
+
 
 // Helpers
 void ignoreLine() {
@@ -39,230 +110,6600 @@ void ignoreLine() {
 
 
 // -----------------------------------------------------------------------------
-// Team class – encapsulates team state and behavior
+// ThreadBufferPool – per-thread buffers that are reused after their thread exits
+// -----------------------------------------------------------------------------
+// A thread takes a buffer on first use through a thread_local Lease and hands
+// it back when it exits. The next new thread picks it up with its contents, so
+// whatever exited threads recorded stays visible, and the number of buffers is
+// bounded by the most threads ever alive at once rather than by how many were
+// ever started.
+template <typename T>
+class ThreadBufferPool {
+    private:
+        std::mutex mutex_;
+        std::vector<std::unique_ptr<T>> buffers_; // every buffer handed out so far
+        std::vector<T*> free_;
+
+        T* acquire() {
+            std::lock_guard lock(mutex_);
+            if (!free_.empty()) {
+                T* buffer = free_.back();
+                free_.pop_back();
+                return buffer;
+            }
+            buffers_.push_back(std::make_unique<T>());
+            return buffers_.back().get();
+        }
+
+        void release(T* buffer) {
+            std::lock_guard lock(mutex_);
+            free_.push_back(buffer);
+        }
+
+    public:
+        class Lease {
+            private:
+                ThreadBufferPool& pool_;
+                T* buffer_;
+
+            public:
+                explicit Lease(ThreadBufferPool& pool) : pool_(pool), buffer_(pool.acquire()) {}
+                Lease(const Lease&) = delete;
+                Lease& operator=(const Lease&) = delete;
+                ~Lease() { pool_.release(buffer_); }
+
+                T& get() const noexcept { return *buffer_; }
+        };
+
+        // Visits every buffer, in use or not; holds the pool lock meanwhile
+        template <typename Fn>
+        void forEach(Fn&& fn) {
+            std::lock_guard lock(mutex_);
+            for (const auto& buffer : buffers_) { fn(*buffer); }
+        }
+
+        std::size_t size() {
+            std::lock_guard lock(mutex_);
+            return buffers_.size();
+        }
+};
+
+
+// -----------------------------------------------------------------------------
+// Latency metrics – optional per-action histograms
+// -----------------------------------------------------------------------------
+// Compile with -DHOCKEY_METRICS to enable. Without it HOCKEY_LATENCY expands to
+// nothing, so the instrumented code is exactly what it was before.
+enum class Metric : unsigned char {
+    AddEvent = 0, GoalForHome, GoalForAway, CardForHome, CardForAway,
+    PenaltyCornerForHome, PenaltyCornerForAway, NextQuarter,
+    PrintScoreboard, PrintEventLog, Count
+};
+
+constexpr std::string_view metricName(Metric metric) noexcept {
+    switch (metric) {
+        case Metric::AddEvent:             return "addEvent";
+        case Metric::GoalForHome:          return "goalForHome";
+        case Metric::GoalForAway:          return "goalForAway";
+        case Metric::CardForHome:          return "cardForHome";
+        case Metric::CardForAway:          return "cardForAway";
+        case Metric::PenaltyCornerForHome: return "penaltyCornerForHome";
+        case Metric::PenaltyCornerForAway: return "penaltyCornerForAway";
+        case Metric::NextQuarter:          return "nextQuarter";
+        case Metric::PrintScoreboard:      return "printScoreboard";
+        case Metric::PrintEventLog:        return "printEventLog";
+        case Metric::Count:                break;
+    }
+    return "unknown";
+}
+
+#ifdef HOCKEY_METRICS
+
+// HDR-style log-linear histogram: values below 16 ns are exact, above that each
+// power of two is split into 16 sub-buckets (~6% relative error) up to ~2 days.
+// Only the owning thread writes, so recording is a relaxed load + store.
+class LatencyHistogram {
+    private:
+        static constexpr int kSubBits = 4;
+        static constexpr int kSub = 1 << kSubBits;
+        static constexpr int kMagnitudes = 44;
+
+        std::array<std::atomic<std::uint64_t>, kSub + kMagnitudes * kSub> counts_{};
+
+    public:
+        static constexpr int kBuckets = kSub + kMagnitudes * kSub;
+
+        static int bucketFor(std::uint64_t ns) noexcept {
+            if (ns < kSub) { return static_cast<int>(ns); }
+            const int shift = static_cast<int>(std::bit_width(ns)) - 1 - kSubBits;
+            const int bucket = kSub + shift * kSub + static_cast<int>((ns >> shift) - kSub);
+            return std::min(bucket, kBuckets - 1);
+        }
+
+        // Largest value that lands in the bucket
+        static std::uint64_t bucketUpper(int bucket) noexcept {
+            if (bucket < kSub) { return static_cast<std::uint64_t>(bucket); }
+            const int shift = (bucket - kSub) / kSub;
+            const std::uint64_t sub = static_cast<std::uint64_t>((bucket - kSub) % kSub);
+            return ((kSub + sub + 1) << shift) - 1;
+        }
+
+        void record(std::uint64_t ns) noexcept {
+            auto& slot = counts_[static_cast<std::size_t>(bucketFor(ns))];
+            slot.store(slot.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+
+        std::uint64_t count(int bucket) const noexcept {
+            return counts_[static_cast<std::size_t>(bucket)].load(std::memory_order_relaxed);
+        }
+};
+
+struct LatencySummary {
+    std::uint64_t count = 0;
+    std::uint64_t p50 = 0, p90 = 0, p99 = 0, p999 = 0, max = 0; // nanoseconds
+};
+
+// Each thread gets its own histograms on first use; readers merge them all.
+// Registration takes a lock once per thread, recording never does. When a
+// thread exits its histograms go to the next new thread, which keeps adding
+// to the same counts.
+class LatencyRegistry {
+    private:
+        using ThreadHistograms = std::array<LatencyHistogram, static_cast<std::size_t>(Metric::Count)>;
+
+        ThreadBufferPool<ThreadHistograms> threads_;
+
+    public:
+        static LatencyRegistry& instance() {
+            static LatencyRegistry registry;
+            return registry;
+        }
+
+        void record(Metric metric, std::uint64_t ns) {
+            thread_local const ThreadBufferPool<ThreadHistograms>::Lease lease(threads_);
+            lease.get()[static_cast<std::size_t>(metric)].record(ns);
+        }
+
+        LatencySummary summary(Metric metric) {
+            std::array<std::uint64_t, LatencyHistogram::kBuckets> merged{};
+            threads_.forEach([&](const ThreadHistograms& histograms) {
+                const auto& histogram = histograms[static_cast<std::size_t>(metric)];
+                for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                    merged[static_cast<std::size_t>(b)] += histogram.count(b);
+                }
+            });
+
+            LatencySummary result;
+            for (const auto n : merged) { result.count += n; }
+            if (result.count == 0) { return result; }
+
+            const auto rank = [&](double q) { return static_cast<std::uint64_t>(q * static_cast<double>(result.count - 1)) + 1; };
+            const std::uint64_t ranks[] = {rank(0.50), rank(0.90), rank(0.99), rank(0.999)};
+            std::uint64_t* targets[] = {&result.p50, &result.p90, &result.p99, &result.p999};
+            std::uint64_t seen = 0;
+            std::size_t next = 0;
+            for (int b = 0; b < LatencyHistogram::kBuckets; ++b) {
+                const auto n = merged[static_cast<std::size_t>(b)];
+                if (n == 0) { continue; }
+                seen += n;
+                while (next < 4 && seen >= ranks[next]) { *targets[next++] = LatencyHistogram::bucketUpper(b); }
+                result.max = LatencyHistogram::bucketUpper(b);
+            }
+            return result;
+        }
+};
+
+class ScopedLatency {
+    private:
+        Metric metric_;
+        std::chrono::steady_clock::time_point start_ = std::chrono::steady_clock::now();
+
+    public:
+        explicit ScopedLatency(Metric metric) noexcept : metric_(metric) {}
+        ScopedLatency(const ScopedLatency&) = delete;
+        ScopedLatency& operator=(const ScopedLatency&) = delete;
+
+        ~ScopedLatency() {
+            const auto elapsed = std::chrono::steady_clock::now() - start_;
+            LatencyRegistry::instance().record(metric_,
+                static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count()));
+        }
+};
+
+#define HOCKEY_LATENCY(metric) const ScopedLatency hockey_latency_scope_(metric)
+
+std::string latencyReport() {
+    std::string report = "\n--- Latency (ns) ---\n";
+    report += std::format("{:<22}{:>10}{:>10}{:>10}{:>10}{:>10}{:>12}\n",
+                          "action", "count", "p50", "p90", "p99", "p99.9", "max");
+    for (int m = 0; m < static_cast<int>(Metric::Count); ++m) {
+        const auto stats = LatencyRegistry::instance().summary(static_cast<Metric>(m));
+        report += std::format("{:<22}{:>10}{:>10}{:>10}{:>10}{:>10}{:>12}\n",
+                              metricName(static_cast<Metric>(m)), stats.count,
+                              stats.p50, stats.p90, stats.p99, stats.p999, stats.max);
+    }
+    report += "--------------------\n\n";
+    return report;
+}
+
+// Machine-readable version of latencyReport()
+void writeLatencyStatsFile(const std::string& path) {
+    std::string json = "{\"unit\":\"ns\",\"metrics\":[";
+    for (int m = 0; m < static_cast<int>(Metric::Count); ++m) {
+        const auto stats = LatencyRegistry::instance().summary(static_cast<Metric>(m));
+        json += std::format("{}{{\"name\":\"{}\",\"count\":{},\"p50\":{},\"p90\":{},\"p99\":{},\"p999\":{},\"max\":{}}}",
+                            m == 0 ? "" : ",", metricName(static_cast<Metric>(m)), stats.count,
+                            stats.p50, stats.p90, stats.p99, stats.p999, stats.max);
+    }
+    json += "]}\n";
+
+    std::ofstream file(path, std::ios::trunc);
+    if (!(file << json)) {
+        throw std::runtime_error("cannot write " + path);
+    }
+}
+
+#else
+#define HOCKEY_LATENCY(metric) ((void)0)
+#endif
+
+
+// -----------------------------------------------------------------------------
+// Tracing – timeline spans dumped in Chrome trace format
+// -----------------------------------------------------------------------------
+// Cheap enough to leave on: a span is two counter reads and a few relaxed
+// stores into a per-thread ring buffer. The rings keep the most recent spans
+// and are only converted to JSON (chrome://tracing, ui.perfetto.dev) on dump.
+
+// Raw CPU tick counter; converted to time only when the trace is written
+inline std::uint64_t readTicks() noexcept {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    std::uint64_t ticks = 0;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(ticks));
+    return ticks;
+#else
+    return static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+class TraceRecorder {
+    private:
+        static constexpr std::size_t kRingSize = 16384; // spans kept per thread
+
+        // Fields are relaxed atomics so a dump can run while threads keep
+        // recording; a span being overwritten mid-dump may come out mixed.
+        struct Span {
+            std::atomic<const char*> name{nullptr};
+            std::atomic<std::uint64_t> begin{0};
+            std::atomic<std::uint64_t> end{0};
+        };
+
+        // A ring outlives its thread and is reused by the next new one, which
+        // then shows up on the same row of the trace
+        struct ThreadRing {
+            static inline std::atomic<int> next_tid{0};
+
+            const int tid = ++next_tid;
+            std::atomic<std::uint64_t> written{0};
+            std::array<Span, kRingSize> spans;
+        };
+
+        ThreadBufferPool<ThreadRing> threads_;
+        const std::uint64_t origin_ticks_ = readTicks();
+        const std::chrono::steady_clock::time_point origin_time_ = std::chrono::steady_clock::now();
+
+        // Ticks per microsecond, measured against steady_clock since startup
+        double ticksPerMicrosecond() const {
+            auto elapsed = std::chrono::steady_clock::now() - origin_time_;
+            if (elapsed < std::chrono::milliseconds(10)) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                elapsed = std::chrono::steady_clock::now() - origin_time_;
+            }
+            const double micros = std::chrono::duration<double, std::micro>(elapsed).count();
+            return static_cast<double>(readTicks() - origin_ticks_) / micros;
+        }
+
+    public:
+        static TraceRecorder& instance() {
+            static TraceRecorder recorder;
+            return recorder;
+        }
+
+        void record(const char* name, std::uint64_t begin, std::uint64_t end) noexcept {
+            thread_local const ThreadBufferPool<ThreadRing>::Lease lease(threads_);
+            ThreadRing& ring = lease.get();
+            const std::uint64_t n = ring.written.load(std::memory_order_relaxed);
+            Span& span = ring.spans[n % kRingSize];
+            span.name.store(name, std::memory_order_relaxed);
+            span.begin.store(begin, std::memory_order_relaxed);
+            span.end.store(end, std::memory_order_relaxed);
+            ring.written.store(n + 1, std::memory_order_release);
+        }
+
+        // Writes everything still in the rings as Chrome trace JSON
+        void writeChromeTrace(const std::string& path) {
+            struct Copy { const char* name; int tid; std::uint64_t begin, end; };
+            std::vector<Copy> spans;
+            threads_.forEach([&](const ThreadRing& ring) {
+                const std::uint64_t written = ring.written.load(std::memory_order_acquire);
+                const std::uint64_t oldest = written > kRingSize ? written - kRingSize : 0;
+                for (std::uint64_t i = oldest; i < written; ++i) {
+                    const Span& span = ring.spans[i % kRingSize];
+                    spans.push_back({span.name.load(std::memory_order_relaxed), ring.tid,
+                                     span.begin.load(std::memory_order_relaxed),
+                                     span.end.load(std::memory_order_relaxed)});
+                }
+            });
+
+            std::uint64_t base = std::numeric_limits<std::uint64_t>::max();
+            for (const auto& span : spans) { base = std::min(base, span.begin); }
+
+            const double rate = ticksPerMicrosecond();
+            std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+            bool first = true;
+            for (const auto& span : spans) {
+                if (span.name == nullptr || span.end < span.begin) { continue; } // torn by a concurrent write
+                json += std::format("{}{{\"name\":\"{}\",\"ph\":\"X\",\"pid\":1,\"tid\":{},\"ts\":{:.3f},\"dur\":{:.3f}}}",
+                                    first ? "" : ",\n", span.name, span.tid,
+                                    static_cast<double>(span.begin - base) / rate,
+                                    static_cast<double>(span.end - span.begin) / rate);
+                first = false;
+            }
+            json += "]}\n";
+
+            std::ofstream file(path, std::ios::trunc);
+            if (!(file << json)) {
+                throw std::runtime_error("cannot write " + path);
+            }
+        }
+};
+
+// Records the enclosing scope; name must be a string literal
+class TraceSpan {
+    private:
+        const char* name_;
+        std::uint64_t begin_ = readTicks();
+
+    public:
+        explicit TraceSpan(const char* name) noexcept : name_(name) {}
+        TraceSpan(const TraceSpan&) = delete;
+        TraceSpan& operator=(const TraceSpan&) = delete;
+
+        ~TraceSpan() { TraceRecorder::instance().record(name_, begin_, readTicks()); }
+};
+
+#define HOCKEY_TRACE(name) const TraceSpan hockey_trace_span_(name)
+
+
+// -----------------------------------------------------------------------------
+// Low-level output helpers – raw file descriptors, no iostream in the way
+// -----------------------------------------------------------------------------
+int openForWrite(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("cannot open " + path + " for writing");
+    }
+    return fd;
+}
+
+// write() may accept fewer bytes than asked for, so loop until done. Each call
+// asks for at most INT_MAX bytes, which fits the Windows and POSIX signatures.
+void writeAll(int fd, std::string_view data) {
+    HOCKEY_TRACE("write");
+    while (!data.empty()) {
+        const auto chunk = std::min<std::size_t>(data.size(), std::numeric_limits<int>::max());
+        const auto written = ::write(fd, data.data(), static_cast<unsigned>(chunk));
+        if (written < 0) {
+            if (errno == EINTR) { continue; }
+            throw std::runtime_error("write failed");
+        }
+        data.remove_prefix(static_cast<std::size_t>(written));
+    }
+}
+
+template <typename Int>
+void appendInt(std::string& out, Int value) {
+    char digits[24];
+    const auto result = std::to_chars(digits, digits + sizeof(digits), value);
+    out.append(digits, result.ptr);
+}
+
+
+// -----------------------------------------------------------------------------
+// OutputSink – everything that renders text writes through one of these
+// -----------------------------------------------------------------------------
+// Keeps rendering independent of std::cout: the console gets a buffered fd
+// writer, benchmarks a NullSink, tests a BufferSink, several displays a FanoutSink.
+class OutputSink {
+    public:
+        virtual ~OutputSink() = default;
+        virtual void write(std::string_view text) = 0;
+        virtual void flush() {}
+
+        template <typename... Args>
+        void print(std::format_string<Args...> fmt, Args&&... args) {
+            write(std::format(fmt, std::forward<Args>(args)...));
+        }
+};
+
+// Buffers until flush() (or a full buffer); large writes skip the buffer
+class FdSink : public OutputSink {
+    private:
+        static constexpr std::size_t kCapacity = std::size_t{64} << 10;
+
+        int fd_;
+        std::string buffer_;
+
+    public:
+        explicit FdSink(int fd) : fd_(fd) { buffer_.reserve(kCapacity); }
+        FdSink(const FdSink&) = delete;
+        FdSink& operator=(const FdSink&) = delete;
+
+        ~FdSink() override {
+            try { flush(); } catch (...) {} // destructors must not throw - call flush() to see errors
+        }
+
+        void write(std::string_view text) override {
+            if (buffer_.size() + text.size() > kCapacity) {
+                flush();
+                if (text.size() >= kCapacity) {
+                    writeAll(fd_, text);
+                    return;
+                }
+            }
+            buffer_ += text;
+        }
+
+        void flush() override {
+            if (buffer_.empty()) { return; }
+            writeAll(fd_, buffer_);
+            buffer_.clear();
+        }
+};
+
+class NullSink : public OutputSink {
+    public:
+        void write(std::string_view) override {}
+};
+
+class BufferSink : public OutputSink {
+    private:
+        std::string buffer_;
+
+    public:
+        void write(std::string_view text) override { buffer_ += text; }
+
+        const std::string& str() const noexcept { return buffer_; }
+        void clear() noexcept { buffer_.clear(); }
+};
+
+// Copies everything to each target; the targets must outlive the fan-out
+class FanoutSink : public OutputSink {
+    private:
+        std::vector<OutputSink*> targets_;
+
+    public:
+        void add(OutputSink& target) { targets_.push_back(&target); }
+
+        void write(std::string_view text) override {
+            for (auto* target : targets_) { target->write(text); }
+        }
+
+        void flush() override {
+            for (auto* target : targets_) { target->flush(); }
+        }
+};
+
+
+// -----------------------------------------------------------------------------
+// Plain counters – a copyable snapshot of what the scoreboard shows
+// -----------------------------------------------------------------------------
+struct TeamCounters {
+    int goals = 0, green = 0, yellow = 0, red = 0, penalty_corners = 0;
+    int corner_goals = 0; // goals scored from a penalty corner (also counted in goals)
+
+    std::string statsLine() const {
+        std::ostringstream oss;
+        oss << green << "G "
+            << yellow << "Y "
+            << red << "R "
+            << penalty_corners << "PC";
+        return oss.str();
+    }
+
+    // Penalty-corner conversion, e.g. "PC conv 2/5 (40%)"
+    std::string conversionLine() const {
+        std::ostringstream oss;
+        oss << "PC conv " << corner_goals << '/' << penalty_corners;
+        if (penalty_corners > 0) {
+            oss << " (" << (100 * corner_goals + penalty_corners / 2) / penalty_corners << "%)";
+        }
+        return oss.str();
+    }
+};
+
+struct ScoreboardState {
+    TeamCounters home;
+    TeamCounters away;
+    int quarter = 1;
+};
+
+// Team names are passed separately - they never change during a match
+void renderScoreboard(OutputSink& out, const std::string& home_name, const std::string& away_name,
+                      const ScoreboardState& state) {
+    HOCKEY_LATENCY(Metric::PrintScoreboard);
+    HOCKEY_TRACE("printScoreboard");
+    out.write("\n=== FIELD HOCKEY SCOREBOARD ===\n");
+
+    out.print("{:<20} {} - {} {:<20}\n",
+        home_name, state.home.goals,
+        state.away.goals, away_name);
+
+    out.print("Quarter: {}/4\n\n", state.quarter);
+
+    out.write("Cards & PCs:\n");
+    out.print("{:<20} {}  {}\n", home_name, state.home.statsLine(), state.home.conversionLine());
+    out.print("{:<20} {}  {}\n", away_name, state.away.statsLine(), state.away.conversionLine());
+    out.write("================================\n\n");
+}
+
+
+// -----------------------------------------------------------------------------
+// Team class – encapsulates team state and behavior
+// -----------------------------------------------------------------------------
+class Team {
+    private: // underscores distinguish private member variables from local variables
+        std::string name_;
+        int goals_ = 0, green_ = 0, yellow_ = 0, red_ = 0, penalty_corners_ = 0;
+        int corner_goals_ = 0;
+
+    public:
+        explicit Team(std::string name) : name_(std::move(name)) {}
+        // "Create a Team from a string. Do not allow implicit conversion.
+        
+        const std::string& name() const noexcept    { return name_; }
+        int goals() const noexcept                  { return goals_; }
+        int penaltyCorners() const noexcept         { return penalty_corners_; }
+        int cornerGoals() const noexcept            { return corner_goals_; }
+
+        int greenCards() const noexcept             { return green_; }
+        int yellowCards() const noexcept            { return yellow_; }
+        int redCards() const noexcept               { return red_; }
+
+        TeamCounters counters() const noexcept {
+            return {goals_, green_, yellow_, red_, penalty_corners_, corner_goals_};
+        }
+    
+
+        // actions - state changes
+        void scoreGoal() noexcept { ++goals_; }
+        void awardPenaltyCorner() noexcept { ++penalty_corners_; }
+        void convertPenaltyCorner() noexcept { ++corner_goals_; } // the goal itself is counted by scoreGoal()
+
+        void receiveCard(CardType type) noexcept {
+            switch (type) {
+                case CardType::Green:  ++green_; break;
+                case CardType::Yellow: ++yellow_; break;
+                case CardType::Red:    ++red_; break;
+                case CardType::Count:  break;
+            }
+        }
+
+        // undo - for a match taking back events (HockeyMatch::rewind)
+        void revokeGoal(bool from_corner) noexcept {
+            --goals_;
+            if (from_corner) { --corner_goals_; }
+        }
+        void revokePenaltyCorner() noexcept { --penalty_corners_; }
+
+        void revokeCard(CardType type) noexcept {
+            switch (type) {
+                case CardType::Green:  --green_; break;
+                case CardType::Yellow: --yellow_; break;
+                case CardType::Red:    --red_; break;
+                case CardType::Count:  break;
+            }
+        }
+
+        // formatted summary:
+        std::string statsLine() const { return counters().statsLine(); }
+};
+
+// -----------------------------------------------------------------------------
+// Small value class representing a single event in the match timeline
+// -----------------------------------------------------------------------------
+class MatchEvent {
+    private:
+        int quarter_;
+        std::uint32_t clock_ms_; // match time since kick-off
+        EventKind kind_;
+        Side side_;
+        CardType card_; // only meaningful for EventKind::Card
+        std::uint8_t player_; // shirt number of the carded player; 0 = not recorded
+        std::string description_;
+
+    public:
+        // constructor:
+        MatchEvent(int quarter, std::uint32_t clock_ms, EventKind kind, Side side, CardType card, std::string description,
+                   std::uint8_t player = 0) :
+            quarter_(quarter), clock_ms_(clock_ms), kind_(kind), side_(side), card_(card), player_(player),
+            description_(std::move(description)) {}
+
+        int quarter() const noexcept                    { return quarter_; }
+        std::uint32_t clockMs() const noexcept          { return clock_ms_; }
+        EventKind kind() const noexcept                 { return kind_; }
+        Side side() const noexcept                      { return side_; }
+        CardType card() const noexcept                  { return card_; }
+        std::uint8_t player() const noexcept            { return player_; }
+        const std::string& description() const noexcept { return description_; }
+
+        std::string toString() const {
+            std::ostringstream oss;
+            oss << "Q" << quarter_ << " - " << description_;
+            return oss.str();
+        }
+};
+
+
+// -----------------------------------------------------------------------------
+// EventLog – append-only event storage that snapshots can share
+// -----------------------------------------------------------------------------
+// Events live in chunks of doubling size (16, 32, 64, ...) that never move once
+// allocated, so indexing stays O(1) and a published snapshot can keep reading
+// the first N events while the owner appends more. Each chunk points to the
+// previous one, so holding the last chunk keeps the whole history alive.
+class EventLog {
+    public:
+        struct Chunk {
+            std::shared_ptr<const Chunk> prev;
+            std::vector<MatchEvent> events; // reserved up front - never reallocates
+        };
+
+        // Read-only view of the first size() events, safe to use from any
+        // thread while the owner keeps appending
+        class View {
+            private:
+                std::shared_ptr<const Chunk> tail_;
+                std::size_t size_ = 0;
+
+            public:
+                View() = default;
+                View(std::shared_ptr<const Chunk> tail, std::size_t size) : tail_(std::move(tail)), size_(size) {}
+
+                std::size_t size() const noexcept { return size_; }
+                bool empty() const noexcept       { return size_ == 0; }
+
+                // Oldest first; only touches elements that existed when the view was made
+                template <typename Fn>
+                void forEach(Fn&& fn) const {
+                    std::vector<const Chunk*> chunks;
+                    for (const Chunk* chunk = tail_.get(); chunk != nullptr; chunk = chunk->prev.get()) {
+                        chunks.push_back(chunk);
+                    }
+                    std::size_t left = size_;
+                    for (auto it = chunks.rbegin(); it != chunks.rend() && left > 0; ++it) {
+                        const std::size_t n = std::min(left, chunkCapacity(static_cast<std::size_t>(it - chunks.rbegin())));
+                        const MatchEvent* events = (*it)->events.data();
+                        for (std::size_t i = 0; i < n; ++i) { fn(events[i]); }
+                        left -= n;
+                    }
+                }
+        };
+
+        class Iterator {
+            private:
+                const EventLog* log_;
+                std::size_t index_;
+
+            public:
+                using iterator_category = std::forward_iterator_tag;
+                using value_type = MatchEvent;
+                using difference_type = std::ptrdiff_t;
+                using pointer = const MatchEvent*;
+                using reference = const MatchEvent&;
+
+                Iterator(const EventLog* log, std::size_t index) : log_(log), index_(index) {}
+                reference operator*() const { return (*log_)[index_]; }
+                pointer operator->() const  { return &(*log_)[index_]; }
+                Iterator& operator++()      { ++index_; return *this; }
+                Iterator operator++(int)    { Iterator old = *this; ++index_; return old; }
+                bool operator==(const Iterator& other) const noexcept { return index_ == other.index_; }
+        };
+
+    private:
+        static constexpr std::size_t kFirstChunk = 16;
+
+        std::vector<std::shared_ptr<Chunk>> chunks_;
+        std::size_t size_ = 0;
+
+        static std::size_t chunkCapacity(std::size_t chunk) noexcept { return kFirstChunk << chunk; }
+
+        // Chunk k starts at index kFirstChunk * (2^k - 1)
+        static std::size_t chunkFor(std::size_t index) noexcept {
+            return static_cast<std::size_t>(std::bit_width(index / kFirstChunk + 1)) - 1;
+        }
+
+        static std::size_t chunkStart(std::size_t chunk) noexcept {
+            return kFirstChunk * ((std::size_t{1} << chunk) - 1);
+        }
+
+    public:
+        std::size_t size() const noexcept { return size_; }
+        bool empty() const noexcept       { return size_ == 0; }
+
+        const MatchEvent& operator[](std::size_t index) const {
+            const std::size_t chunk = chunkFor(index);
+            return chunks_[chunk]->events[index - chunkStart(chunk)];
+        }
+
+        const MatchEvent& back() const { return (*this)[size_ - 1]; }
+
+        Iterator begin() const noexcept { return {this, 0}; }
+        Iterator end() const noexcept   { return {this, size_}; }
+
+        template <typename... Args>
+        MatchEvent& emplace_back(Args&&... args) {
+            const std::size_t chunk = chunkFor(size_);
+            if (chunk == chunks_.size()) { reserve(size_ + 1); }
+            ++size_;
+            return chunks_[chunk]->events.emplace_back(std::forward<Args>(args)...);
+        }
+
+        // Drops every event from `count` on. A chunk that a View may still be
+        // reading is replaced by a copy of its kept events instead of being
+        // changed in place.
+        void truncate(std::size_t count) {
+            if (count >= size_) { return; }
+            const std::size_t first = chunkFor(count);
+            bool shared = false;
+            for (std::size_t c = first; c < chunks_.size(); ++c) {
+                // Each chunk is also held by the next one's `prev`
+                shared = shared || chunks_[c].use_count() > (c + 1 < chunks_.size() ? 2 : 1);
+            }
+            const auto kept = static_cast<std::ptrdiff_t>(count - chunkStart(first));
+            if (shared) {
+                auto copy = std::make_shared<Chunk>();
+                copy->prev = chunks_[first]->prev;
+                copy->events.reserve(chunkCapacity(first));
+                const auto& old = chunks_[first]->events;
+                copy->events.assign(old.begin(), old.begin() + kept);
+                chunks_.resize(first);
+                chunks_.push_back(std::move(copy));
+            } else {
+                auto& events = chunks_[first]->events;
+                events.erase(events.begin() + kept, events.end());
+                for (std::size_t c = first + 1; c < chunks_.size(); ++c) { chunks_[c]->events.clear(); }
+            }
+            size_ = count;
+        }
+
+        // Allocates every chunk needed for `count` events now
+        void reserve(std::size_t count) {
+            while (chunks_.size() <= chunkFor(std::max<std::size_t>(count, 1) - 1)) {
+                auto chunk = std::make_shared<Chunk>();
+                chunk->events.reserve(chunkCapacity(chunks_.size()));
+                if (!chunks_.empty()) { chunk->prev = chunks_.back(); }
+                chunks_.push_back(std::move(chunk));
+            }
+        }
+
+        View view() const {
+            return empty() ? View{} : View{chunks_[chunkFor(size_ - 1)], size_};
+        }
+};
+
+
+// -----------------------------------------------------------------------------
+// VersionPublisher – one writer publishes immutable versions, readers never wait
+// -----------------------------------------------------------------------------
+// Epoch-based reclamation: a reader announces the current epoch in its own slot
+// before loading the pointer; the writer frees a retired version only once every
+// active reader announced a later epoch than the one it was retired in.
+template <typename T>
+class VersionPublisher {
+    private:
+        static constexpr std::size_t kMaxReaderThreads = 64;
+        static constexpr std::uint64_t kIdle = std::numeric_limits<std::uint64_t>::max();
+
+        struct alignas(64) ReaderSlot { // own cache line per reader thread
+            std::atomic<std::uint64_t> epoch{kIdle};
+        };
+
+        std::array<ReaderSlot, kMaxReaderThreads> slots_;
+        std::atomic<std::uint64_t> epoch_{1};
+        std::atomic<const T*> current_{nullptr};
+        std::vector<std::pair<std::uint64_t, const T*>> retired_; // writer only
+
+        // Slot numbers are shared by every publisher of this T. A thread takes
+        // one the first time it reads anything and hands it back when it
+        // exits; it holds no guard then, so it is idle in every publisher.
+        static inline std::mutex slot_pool_mutex_;
+        static inline std::vector<std::size_t> free_slots_;
+        static inline std::size_t next_slot_ = 0;
+
+        struct SlotOwner {
+            std::size_t slot;
+
+            SlotOwner() {
+                std::lock_guard lock(slot_pool_mutex_);
+                if (!free_slots_.empty()) {
+                    slot = free_slots_.back();
+                    free_slots_.pop_back();
+                } else if (next_slot_ < kMaxReaderThreads) {
+                    slot = next_slot_++;
+                } else {
+                    throw std::runtime_error("too many reader threads for VersionPublisher");
+                }
+            }
+
+            ~SlotOwner() {
+                std::lock_guard lock(slot_pool_mutex_);
+                free_slots_.push_back(slot);
+            }
+        };
+
+        static std::size_t readerSlot() {
+            thread_local const SlotOwner owner;
+            return owner.slot;
+        }
+
+        void reclaim() {
+            std::uint64_t oldest_reader = kIdle;
+            for (const auto& slot : slots_) {
+                oldest_reader = std::min(oldest_reader, slot.epoch.load());
+            }
+            std::erase_if(retired_, [&](const auto& entry) {
+                if (entry.first >= oldest_reader) { return false; }
+                delete entry.second;
+                return true;
+            });
+        }
+
+    public:
+        class ReadGuard {
+            private:
+                std::atomic<std::uint64_t>* slot_ = nullptr; // null when nested in another guard
+                const T* version_ = nullptr;
+
+            public:
+                ReadGuard(std::atomic<std::uint64_t>& slot, const std::atomic<std::uint64_t>& epoch,
+                          const std::atomic<const T*>& current) {
+                    if (slot.load(std::memory_order_relaxed) == kIdle) {
+                        slot.store(epoch.load()); // seq_cst: must be visible before the pointer load
+                        slot_ = &slot;
+                    }
+                    version_ = current.load();
+                }
+
+                ReadGuard(const ReadGuard&) = delete;
+                ReadGuard& operator=(const ReadGuard&) = delete;
+
+                ~ReadGuard() {
+                    if (slot_ != nullptr) { slot_->store(kIdle, std::memory_order_release); }
+                }
+
+                const T* get() const noexcept        { return version_; }
+                const T* operator->() const noexcept { return version_; }
+                const T& operator*() const noexcept  { return *version_; }
+        };
+
+        VersionPublisher() = default;
+        VersionPublisher(const VersionPublisher&) = delete;
+        VersionPublisher& operator=(const VersionPublisher&) = delete;
+
+        ~VersionPublisher() { // no readers may be left at this point
+            delete current_.load();
+            for (const auto& entry : retired_) { delete entry.second; }
+        }
+
+        // Writer side: swap in the new version and free what no reader can still see
+        void publish(std::unique_ptr<const T> version) {
+            const T* old = current_.exchange(version.release());
+            if (old != nullptr) {
+                retired_.emplace_back(epoch_.fetch_add(1), old);
+            }
+            reclaim();
+        }
+
+        // Wait-free: one store and one load. Keep the guard short-lived.
+        ReadGuard read() const {
+            auto& slot = const_cast<ReaderSlot&>(slots_[readerSlot()]);
+            return ReadGuard(slot.epoch, epoch_, current_);
+        }
+};
+
+
+// -----------------------------------------------------------------------------
+// MatchVersion – immutable committed state handed to concurrent readers
+// -----------------------------------------------------------------------------
+struct MatchVersion {
+    std::uint64_t number;  // 1 = first version published
+    ScoreboardState state;
+    EventLog::View events; // shares chunks with the live log - nothing is copied
+};
+
+// -----------------------------------------------------------------------------
+// MatchAction – compact description of one game action, for batches
+// -----------------------------------------------------------------------------
+enum class ActionKind : unsigned char { Goal = 0, Card, PenaltyCorner, NextQuarter };
+
+struct MatchAction {
+    static constexpr std::uint32_t kLiveClock = std::numeric_limits<std::uint32_t>::max();
+
+    ActionKind kind = ActionKind::Goal;
+    Side side = Side::None;          // required for everything but NextQuarter
+    CardType card = CardType::Count; // required for Card
+    std::uint32_t clock_ms = kLiveClock; // match time to record; kLiveClock = the match's own clock
+    std::uint8_t player = 0;         // Card only: shirt number, 0 = not recorded
+};
+
+// The action that reproduces a logged event, built from raw bytes a peer or a
+// file handed us. Throws if the bytes are not a valid event; nullopt for
+// QuarterStart, which the replayed nextQuarter logs by itself.
+inline std::optional<MatchAction> replayAction(std::uint8_t kind, std::uint8_t side, std::uint8_t card,
+                                               std::uint32_t clock_ms, std::uint8_t player = 0) {
+    if (kind >= static_cast<std::uint8_t>(EventKind::Count) || side > static_cast<std::uint8_t>(Side::Away) ||
+        card > static_cast<std::uint8_t>(CardType::Count)) {
+        throw std::runtime_error(std::format("invalid event bytes (kind {}, side {}, card {})", kind, side, card));
+    }
+    const auto as_side = static_cast<Side>(side);
+    const auto as_card = static_cast<CardType>(card);
+    switch (static_cast<EventKind>(kind)) {
+        case EventKind::Goal:          return MatchAction{ActionKind::Goal, as_side, as_card, clock_ms};
+        case EventKind::Card:          return MatchAction{ActionKind::Card, as_side, as_card, clock_ms, player};
+        case EventKind::PenaltyCorner: return MatchAction{ActionKind::PenaltyCorner, as_side, as_card, clock_ms};
+        case EventKind::QuarterEnd:    return MatchAction{ActionKind::NextQuarter, as_side, as_card, clock_ms};
+        case EventKind::QuarterStart:  return std::nullopt;
+        case EventKind::Count:         break;
+    }
+    return std::nullopt;
+}
+
+
+// -----------------------------------------------------------------------------
+// MatchObserver – hook for anything that follows a match event by event
+// -----------------------------------------------------------------------------
+class HockeyMatch;
+
+class MatchObserver {
+    public:
+        virtual ~MatchObserver() = default;
+
+        // Called after the event is in the log and the team counters include it
+        virtual void onEvent(const HockeyMatch& match, const MatchEvent& event) = 0;
+
+        // Events from index `kept` on were taken back (HockeyMatch::rewind).
+        // Those that still stand are delivered again through onEvent().
+        virtual void onRewind(const HockeyMatch& /*match*/, std::size_t /*kept*/) {}
+
+        // True if onRewind() undoes what the taken-back events counted. A
+        // match that can rewind (ReplicatedEventLog) refuses other observers,
+        // since they would count the replayed events twice.
+        virtual bool followsRewind() const noexcept { return false; }
+};
+
+enum class ActionResult : unsigned char { Applied = 0, MissingSide, InvalidCard, MatchOver, InvalidKind };
+
+constexpr std::string_view actionResultName(ActionResult result) noexcept {
+    switch (result) {
+        case ActionResult::Applied:     return "applied";
+        case ActionResult::MissingSide: return "action needs a home or away side";
+        case ActionResult::InvalidCard: return "card action without a valid card type";
+        case ActionResult::MatchOver:   return "match is already over";
+        case ActionResult::InvalidKind: return "unknown action";
+    }
+    return "unknown";
+}
+
+
+// -----------------------------------------------------------------------------
+// HockeyMatch class – core match orchestration
+// -----------------------------------------------------------------------------
+class HockeyMatch {
+    private:
+        std::uint32_t id_; // identifies the match in exports and archives
+        Team home_team_;
+        Team away_team_;
+        int current_quarter_ = 1;
+        bool finished_ = false; // set when Q4 ends
+        std::chrono::steady_clock::time_point kick_off_ = std::chrono::steady_clock::now();
+        std::uint32_t replay_clock_ms_ = MatchAction::kLiveClock; // set while applying timestamped actions
+        EventLog event_log_; // Chronological list of all events
+        std::vector<MatchObserver*> observers_;
+        std::unique_ptr<VersionPublisher<MatchVersion>> versions_; // only when enableVersions() was called
+        std::array<std::string, 2> goal_text_, corner_text_; // by team: home, away
+        std::array<std::array<std::string, static_cast<std::size_t>(CardType::Count)>, 2> card_text_;
+        std::uint64_t version_number_ = 0;
+
+        // Penalty corner still in play: a goal by this side within kCornerWindowMs,
+        // with nothing else logged in between, came from it
+        static constexpr std::uint32_t kCornerWindowMs = 60'000;
+        Side open_corner_ = Side::None;
+        std::uint32_t open_corner_clock_ = 0;
+
+        // Called once per committed action
+        void publishVersion() {
+            if (!versions_) { return; }
+            versions_->publish(std::make_unique<const MatchVersion>(
+                MatchVersion{++version_number_, state(), event_log_.view()}));
+        }
+
+        void addEvent(EventKind kind, Side side, CardType card, const std::string& event_description,
+                      std::uint8_t player = 0) {
+            HOCKEY_LATENCY(Metric::AddEvent);
+            HOCKEY_TRACE("addEvent");
+            const std::uint32_t clock = (replay_clock_ms_ != MatchAction::kLiveClock) ? replay_clock_ms_ : clockMs();
+            if (kind == EventKind::Goal && side == open_corner_ && clock - open_corner_clock_ <= kCornerWindowMs) {
+                (side == Side::Home ? home_team_ : away_team_).convertPenaltyCorner();
+            }
+            open_corner_ = (kind == EventKind::PenaltyCorner) ? side : Side::None;
+            open_corner_clock_ = clock;
+            const MatchEvent& event = event_log_.emplace_back(current_quarter_, clock, kind, side, card, event_description, player); // emplace_back constructs MatchEvent in-place
+            for (auto* observer : observers_) {
+                observer->onEvent(*this, event);
+            }
+        }
+
+        Side sideOf(const Team& team) const noexcept {
+            return (&team == &home_team_) ? Side::Home : Side::Away;
+        }
+
+        void scoreGoalFor(Team& team, const std::string& scorer = {}) {
+            team.scoreGoal();
+            if (scorer.empty()) {
+                addEvent(EventKind::Goal, sideOf(team), CardType::Count, goal_text_[teamIndex(team)]);
+            } else {
+                addEvent(EventKind::Goal, sideOf(team), CardType::Count, team.name() + " goal! (" + scorer + ")");
+            }
+            publishVersion();
+        }
+
+        static std::string cardText(CardType type, const std::string& team_name, std::uint8_t player) {
+            std::string text = std::string(cardName(type)) + " card - " + team_name;
+            if (player != 0) {
+                text += " #";
+                appendInt(text, player);
+            }
+            return text;
+        }
+
+        void showCardFor(Team& team, CardType type, std::uint8_t player) {
+            team.receiveCard(type);
+            if (player == 0 && type < CardType::Count) {
+                addEvent(EventKind::Card, sideOf(team), type, card_text_[teamIndex(team)][static_cast<std::size_t>(type)]);
+            } else {
+                addEvent(EventKind::Card, sideOf(team), type, cardText(type, team.name(), player), player);
+            }
+            publishVersion();
+        }
+
+        void awardPenaltyCornerFor(Team& team) {
+            team.awardPenaltyCorner();
+            addEvent(EventKind::PenaltyCorner, sideOf(team), CardType::Count, corner_text_[teamIndex(team)]);
+            publishVersion();
+        }
+
+        std::size_t teamIndex(const Team& team) const noexcept { return (&team == &home_team_) ? 0 : 1; }
+
+        // Descriptions only depend on kind/side/card and team names never
+        // change, so they are built once per match
+        void buildTexts() {
+            const std::array<const Team*, 2> teams = {&home_team_, &away_team_};
+            for (std::size_t t = 0; t < 2; ++t) {
+                goal_text_[t] = teams[t]->name() + " goal!";
+                corner_text_[t] = "Penalty corner - " + teams[t]->name();
+                for (std::size_t c = 0; c < card_text_[t].size(); ++c) {
+                    card_text_[t][c] = cardText(static_cast<CardType>(c), teams[t]->name(), 0);
+                }
+            }
+        }
+
+        // Validates `action` against the state the actions before it leave
+        // behind, advancing that state and the count of events it will add
+        static ActionResult check(const MatchAction& action, int& quarter, bool& finished, std::size_t& new_events) {
+            if (action.kind > ActionKind::NextQuarter) { // raw bytes from a peer or a file
+                return ActionResult::InvalidKind;
+            }
+            if (action.kind == ActionKind::NextQuarter) {
+                if (finished) { return ActionResult::MatchOver; }
+                if (quarter < TOTAL_QUARTERS) {
+                    new_events += 2; // end + start
+                    ++quarter;
+                } else {
+                    new_events += 1;
+                    finished = true;
+                }
+                return ActionResult::Applied;
+            }
+            if (action.side != Side::Home && action.side != Side::Away) { return ActionResult::MissingSide; }
+            if (action.kind == ActionKind::Card && action.card >= CardType::Count) { return ActionResult::InvalidCard; }
+            ++new_events;
+            return ActionResult::Applied;
+        }
+
+        // Applies an action check() accepted; the caller publishes the version
+        void applyChecked(const MatchAction& action) {
+            replay_clock_ms_ = action.clock_ms;
+            const std::size_t t = (action.side == Side::Home) ? 0 : 1;
+            Team& team = (t == 0) ? home_team_ : away_team_;
+            switch (action.kind) {
+                case ActionKind::Goal:
+                    team.scoreGoal();
+                    addEvent(EventKind::Goal, action.side, CardType::Count, goal_text_[t]);
+                    break;
+                case ActionKind::Card:
+                    team.receiveCard(action.card);
+                    if (action.player == 0) {
+                        addEvent(EventKind::Card, action.side, action.card, card_text_[t][static_cast<std::size_t>(action.card)]);
+                    } else {
+                        addEvent(EventKind::Card, action.side, action.card, cardText(action.card, team.name(), action.player),
+                                 action.player);
+                    }
+                    break;
+                case ActionKind::PenaltyCorner:
+                    team.awardPenaltyCorner();
+                    addEvent(EventKind::PenaltyCorner, action.side, CardType::Count, corner_text_[t]);
+                    break;
+                case ActionKind::NextQuarter:
+                    finished_ = current_quarter_ >= TOTAL_QUARTERS;
+                    addEvent(EventKind::QuarterEnd, Side::None, CardType::Count,
+                             "=== End of Q" + std::to_string(current_quarter_) + " ===");
+                    if (!finished_) {
+                        ++current_quarter_;
+                        addEvent(EventKind::QuarterStart, Side::None, CardType::Count,
+                                 "=== Start of Q" + std::to_string(current_quarter_) + " ===");
+                    }
+                    break;
+            }
+            replay_clock_ms_ = MatchAction::kLiveClock;
+        }
+
+
+    public:
+    // constructor:
+    HockeyMatch(std::string home_name, std::string away_name, std::uint32_t id = 1)
+        :   id_(id),
+            home_team_(std::move(home_name)),
+            away_team_(std::move(away_name)) {
+            buildTexts();
+            addEvent(EventKind::QuarterStart, Side::None, CardType::Count, "=== Start of Q1 ===");
+        }
+
+
+        // --------------------- Const accessors ---------------------
+        std::uint32_t id() const noexcept                            { return id_; }
+        const Team& home() const noexcept                            { return home_team_; }
+        const Team& away() const noexcept                           { return away_team_; }
+        int quarter() const noexcept                                 { return current_quarter_; }
+        bool finished() const noexcept                               { return finished_; }
+        std::chrono::steady_clock::time_point kickOff() const noexcept { return kick_off_; }
+
+        // Moves kick-off back so that clockMs() carries on from `clock_ms`,
+        // e.g. for a match rebuilt from a journal
+        void continueClockFrom(std::uint32_t clock_ms) noexcept {
+            kick_off_ = std::chrono::steady_clock::now() - std::chrono::milliseconds(clock_ms);
+        }
+
+        // Match time in milliseconds since the match object was created
+        std::uint32_t clockMs() const noexcept {
+            return static_cast<std::uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now() - kick_off_).count());
+        }
+
+        // --------------------- Observers ---------------------
+        // The observer must stay alive until it is removed (or the match is gone)
+        void addObserver(MatchObserver& observer) { observers_.push_back(&observer); }
+
+        void removeObserver(MatchObserver& observer) {
+            std::erase(observers_, &observer);
+        }
+        const EventLog& events() const noexcept                      { return event_log_; }
+
+        // --------------------- Concurrent readers ---------------------
+        // After enableVersions(), every committed action publishes an immutable
+        // MatchVersion. Other threads call latest() instead of the accessors
+        // above (names are safe to read directly - they never change).
+        void enableVersions() {
+            if (versions_) { return; }
+            versions_ = std::make_unique<VersionPublisher<MatchVersion>>();
+            publishVersion();
+        }
+
+        VersionPublisher<MatchVersion>::ReadGuard latest() const {
+            if (!versions_) {
+                throw std::logic_error("HockeyMatch::latest() needs enableVersions()");
+            }
+            return versions_->read();
+        }
+
+
+        // --------------------- Game actions ---------------------
+        void goalForHome() {
+            HOCKEY_LATENCY(Metric::GoalForHome);
+            HOCKEY_TRACE("goalForHome");
+            scoreGoalFor(home_team_);
+        }
+        void goalForAway() {
+            HOCKEY_LATENCY(Metric::GoalForAway);
+            HOCKEY_TRACE("goalForAway");
+            scoreGoalFor(away_team_);
+        }
+
+        // player: shirt number of the carded player, 0 if not known
+        void cardForHome(CardType type, std::uint8_t player = 0) {
+            HOCKEY_LATENCY(Metric::CardForHome);
+            HOCKEY_TRACE("cardForHome");
+            showCardFor(home_team_, type, player);
+        }
+        void cardForAway(CardType type, std::uint8_t player = 0) {
+            HOCKEY_LATENCY(Metric::CardForAway);
+            HOCKEY_TRACE("cardForAway");
+            showCardFor(away_team_, type, player);
+        }
+
+        void penaltyCornerForHome() {
+            HOCKEY_LATENCY(Metric::PenaltyCornerForHome);
+            HOCKEY_TRACE("penaltyCornerForHome");
+            awardPenaltyCornerFor(home_team_);
+        }
+        void penaltyCornerForAway() {
+            HOCKEY_LATENCY(Metric::PenaltyCornerForAway);
+            HOCKEY_TRACE("penaltyCornerForAway");
+            awardPenaltyCornerFor(away_team_);
+        }
+
+        // Returns false when match is over (after quarter 4)
+        bool nextQuarter() {
+            HOCKEY_LATENCY(Metric::NextQuarter);
+            HOCKEY_TRACE("nextQuarter");
+            if (finished_) {
+                return false;
+            }
+        
+            // After Q4 ends, match is over — set first so observers see it with the final whistle
+            if (current_quarter_ >= TOTAL_QUARTERS) {
+                finished_ = true;
+            }
+
+            // Always log the end of the current quarter
+            addEvent(EventKind::QuarterEnd, Side::None, CardType::Count,
+                     "=== End of Q" + std::to_string(current_quarter_) + " ===");
+        
+            if (!finished_) {
+                ++current_quarter_;
+                addEvent(EventKind::QuarterStart, Side::None, CardType::Count,
+                         "=== Start of Q" + std::to_string(current_quarter_) + " ===");
+                publishVersion();
+                return true;
+            }
+        
+            // No start of Q5
+            publishVersion();
+            return false;
+        }
+
+        // --------------------- Batched actions ---------------------
+        // Same effect as calling the single actions one by one, but validates
+        // everything first, grows the log once and publishes a single version
+        // at the end. Invalid actions are skipped; results[i] says what
+        // happened to actions[i].
+        std::vector<ActionResult> applyBatch(std::span<const MatchAction> actions) {
+            HOCKEY_TRACE("applyBatch");
+            std::vector<ActionResult> results(actions.size());
+
+            // Pass 1: validate and count the events we are going to add
+            std::size_t new_events = 0;
+            int quarter = current_quarter_;
+            bool finished = finished_;
+            for (std::size_t i = 0; i < actions.size(); ++i) {
+                results[i] = check(actions[i], quarter, finished, new_events);
+            }
+            event_log_.reserve(event_log_.size() + new_events);
+
+            // Pass 2: apply
+            for (std::size_t i = 0; i < actions.size(); ++i) {
+                if (results[i] == ActionResult::Applied) { applyChecked(actions[i]); }
+            }
+            publishVersion();
+            return results;
+        }
+
+        // One action, as applyBatch() would apply it, without the results vector
+        ActionResult apply(const MatchAction& action) {
+            HOCKEY_TRACE("apply");
+            std::size_t new_events = 0;
+            int quarter = current_quarter_;
+            bool finished = finished_;
+            const ActionResult result = check(action, quarter, finished, new_events);
+            if (result == ActionResult::Applied) {
+                applyChecked(action);
+                publishVersion();
+            }
+            return result;
+        }
+
+        // --------------------- Rewind ---------------------
+        // Takes back every event from index `keep` on, and what they counted, so
+        // that a corrected history can be applied on top. The first event (start
+        // of Q1) always stays. Kick-off, observers and readers are kept;
+        // observers are told through onRewind(), so all of them must follow it.
+        void rewind(std::size_t keep) {
+            keep = std::max<std::size_t>(keep, 1);
+            if (keep >= event_log_.size()) { return; }
+            for (std::size_t i = event_log_.size(); i-- > keep;) {
+                const MatchEvent& event = event_log_[i];
+                Team& team = (event.side() == Side::Home) ? home_team_ : away_team_;
+                switch (event.kind()) {
+                    case EventKind::Goal: {
+                        // Same rule as addEvent(): straight after the team's own corner, within the window
+                        const MatchEvent& before = event_log_[i - 1];
+                        team.revokeGoal(before.kind() == EventKind::PenaltyCorner && before.side() == event.side() &&
+                                        event.clockMs() - before.clockMs() <= kCornerWindowMs);
+                        break;
+                    }
+                    case EventKind::Card:          team.revokeCard(event.card()); break;
+                    case EventKind::PenaltyCorner: team.revokePenaltyCorner(); break;
+                    case EventKind::QuarterEnd:    finished_ = false; break;
+                    case EventKind::QuarterStart:  --current_quarter_; break;
+                    case EventKind::Count:         break;
+                }
+            }
+            event_log_.truncate(keep);
+            const MatchEvent& last = event_log_.back();
+            open_corner_ = (last.kind() == EventKind::PenaltyCorner) ? last.side() : Side::None;
+            open_corner_clock_ = last.clockMs();
+            for (auto* observer : observers_) {
+                observer->onRewind(*this, keep);
+            }
+            publishVersion();
+        }
+
+        // --------------------- Display functions ---------------------
+        ScoreboardState state() const noexcept {
+            return {home_team_.counters(), away_team_.counters(), current_quarter_};
+        }
+
+        void printScoreboard(OutputSink& out) const {
+            renderScoreboard(out, home_team_.name(), away_team_.name(), state());
+        }
+
+
+        void printEventLog(OutputSink& out) const {
+            HOCKEY_LATENCY(Metric::PrintEventLog);
+            HOCKEY_TRACE("printEventLog");
+            out.write("\n--- Event Log ---\n");
+            if (event_log_.empty()) {
+                out.write("No events yet.\n");
+            } else {
+                for (const auto& event : event_log_) {
+                    out.print("Q{} - {}\n", event.quarter(), event.description());
+                }
+            }
+            out.write("-----------------\n\n");
+        }
+};
+
+// -----------------------------------------------------------------------------
+// EventExporter – streams event logs as NDJSON or CSV lines
+// -----------------------------------------------------------------------------
+// Every line is appended straight into one big buffer (no per-event strings)
+// and the buffer goes to the sink in large chunks (FdSink passes those
+// straight to write()).
+// Each match starts with two "team" records naming home and away, so an
+// export can be loaded back into HockeyMatch state.
+enum class ExportFormat : unsigned char { Ndjson, Csv };
+
+class EventExporter {
+    private:
+        static constexpr std::size_t kFlushThreshold = std::size_t{1} << 20; // 1 MiB
+
+        OutputSink& out_;
+        ExportFormat format_;
+        std::string buffer_;
+
+        static void appendJsonString(std::string& out, std::string_view text) {
+            out += '"';
+            for (const char c : text) {
+                switch (c) {
+                    case '"':  out += "\\\""; break;
+                    case '\\': out += "\\\\"; break;
+                    case '\n': out += "\\n"; break;
+                    case '\r': out += "\\r"; break;
+                    case '\t': out += "\\t"; break;
+                    default:
+                        if (static_cast<unsigned char>(c) < 0x20) {
+                            constexpr char hex[] = "0123456789abcdef";
+                            out += "\\u00";
+                            out += hex[(c >> 4) & 0xF];
+                            out += hex[c & 0xF];
+                        } else {
+                            out += c;
+                        }
+                }
+            }
+            out += '"';
+        }
+
+        // CSV text is always quoted; embedded quotes are doubled
+        static void appendCsvString(std::string& out, std::string_view text) {
+            out += '"';
+            for (const char c : text) {
+                if (c == '"') { out += '"'; }
+                out += c;
+            }
+            out += '"';
+        }
+
+        static void formatRecord(std::string& out, ExportFormat format, std::uint32_t match_id, int quarter,
+                                 std::uint32_t clock_ms, std::string_view kind, std::string_view side,
+                                 std::string_view card, std::string_view text) {
+            if (format == ExportFormat::Ndjson) {
+                out += "{\"match\":";
+                appendInt(out, match_id);
+                out += ",\"quarter\":";
+                appendInt(out, quarter);
+                out += ",\"clock_ms\":";
+                appendInt(out, clock_ms);
+                out += ",\"kind\":\"";
+                out += kind;
+                out += "\",\"side\":\"";
+                out += side;
+                out += "\",\"card\":\"";
+                out += card;
+                out += "\",\"text\":";
+                appendJsonString(out, text);
+                out += "}\n";
+            } else {
+                appendInt(out, match_id);
+                out += ',';
+                appendInt(out, quarter);
+                out += ',';
+                appendInt(out, clock_ms);
+                out += ',';
+                out += kind;
+                out += ',';
+                out += side;
+                out += ',';
+                out += card;
+                out += ',';
+                appendCsvString(out, text);
+                out += '\n';
+            }
+        }
+
+        void appendRecord(std::uint32_t match_id, int quarter, std::uint32_t clock_ms, std::string_view kind,
+                          std::string_view side, std::string_view card, std::string_view text) {
+            formatRecord(buffer_, format_, match_id, quarter, clock_ms, kind, side, card, text);
+            if (buffer_.size() >= kFlushThreshold) {
+                flush();
+            }
+        }
+
+    public:
+        static constexpr std::string_view kCsvHeader = "match,quarter,clock_ms,kind,side,card,text\n";
+
+        EventExporter(OutputSink& out, ExportFormat format) : out_(out), format_(format) {
+            buffer_.reserve(kFlushThreshold + 4096);
+            if (format_ == ExportFormat::Csv) {
+                buffer_ += kCsvHeader;
+            }
+        }
+
+        // Appends events [begin, end) of the match to `out` - preceded by its
+        // team records when begin is 0. Used to format chunks independently.
+        static void appendEvents(std::string& out, ExportFormat format, const HockeyMatch& match,
+                                 std::size_t begin, std::size_t end) {
+            if (begin == 0) {
+                formatRecord(out, format, match.id(), 0, 0, "team", sideName(Side::Home), "", match.home().name());
+                formatRecord(out, format, match.id(), 0, 0, "team", sideName(Side::Away), "", match.away().name());
+            }
+            const EventLog& events = match.events();
+            for (std::size_t i = begin; i < end; ++i) {
+                const MatchEvent& event = events[i];
+                const std::string_view card = (event.kind() == EventKind::Card) ? cardName(event.card()) : "";
+                formatRecord(out, format, match.id(), event.quarter(), event.clockMs(), eventKindName(event.kind()),
+                             sideName(event.side()), card, event.description());
+            }
+        }
+
+        EventExporter(const EventExporter&) = delete;
+        EventExporter& operator=(const EventExporter&) = delete;
+
+        ~EventExporter() {
+            try { flush(); } catch (...) {} // destructors must not throw - call flush() to see errors
+        }
+
+        void writeMatch(const HockeyMatch& match) {
+            appendRecord(match.id(), 0, 0, "team", sideName(Side::Home), "", match.home().name());
+            appendRecord(match.id(), 0, 0, "team", sideName(Side::Away), "", match.away().name());
+            for (const auto& event : match.events()) {
+                const std::string_view card = (event.kind() == EventKind::Card) ? cardName(event.card()) : "";
+                appendRecord(match.id(), event.quarter(), event.clockMs(), eventKindName(event.kind()),
+                             sideName(event.side()), card, event.description());
+            }
+        }
+
+        void flush() {
+            out_.write(buffer_);
+            buffer_.clear();
+            out_.flush();
+        }
+};
+
+// -----------------------------------------------------------------------------
+// ParallelExporter – formats big exports on several threads, writes them in order
+// -----------------------------------------------------------------------------
+// The event logs are cut into chunks of kChunkEvents events. Worker threads
+// claim chunks in order and each formats its chunk into its own buffer. The
+// calling thread writes finished chunks in file order, gathering each run of
+// ready buffers into one writev(). Workers stay at most a few chunks per
+// thread ahead of the writer, so a slow disk does not pile up memory.
+class ParallelExporter {
+    private:
+        static constexpr std::size_t kChunkEvents = 32768;
+        static constexpr std::size_t kMaxBuffersPerWrite = 64;
+
+        struct Chunk {
+            const HockeyMatch* match;
+            std::size_t begin, end;
+            std::string text;
+            bool ready = false;
+        };
+
+        // Writes every buffer, however many calls it takes
+        static void writeBuffers(int fd, std::span<std::string> buffers) {
+        #ifdef _WIN32
+            for (const auto& buffer : buffers) { writeAll(fd, buffer); }
+        #else
+            HOCKEY_TRACE("writev");
+            std::array<iovec, kMaxBuffersPerWrite> iov;
+            std::size_t count = 0;
+            for (auto& buffer : buffers) {
+                if (!buffer.empty()) { iov[count++] = {buffer.data(), buffer.size()}; }
+            }
+            iovec* next = iov.data();
+            while (count > 0) {
+                const auto written = ::writev(fd, next, static_cast<int>(count));
+                if (written < 0) {
+                    if (errno == EINTR) { continue; }
+                    throw std::runtime_error("write failed");
+                }
+                auto left = static_cast<std::size_t>(written);
+                while (count > 0 && left >= next->iov_len) { // skip what was fully written
+                    left -= next->iov_len;
+                    ++next;
+                    --count;
+                }
+                if (count > 0) {
+                    next->iov_base = static_cast<char*>(next->iov_base) + left;
+                    next->iov_len -= left;
+                }
+            }
+        #endif
+        }
+
+    public:
+        // Writes the matches to fd in EventExporter's format; returns the number of events written
+        static std::size_t write(int fd, std::span<const HockeyMatch* const> matches, ExportFormat format,
+                                 unsigned threads = std::thread::hardware_concurrency()) {
+            HOCKEY_TRACE("exportParallel");
+            std::vector<Chunk> chunks;
+            std::size_t events = 0;
+            for (const auto* match : matches) {
+                const std::size_t size = match->events().size();
+                events += size;
+                for (std::size_t begin = 0; begin == 0 || begin < size; begin += kChunkEvents) {
+                    chunks.push_back({match, begin, std::min(size, begin + kChunkEvents), {}});
+                }
+            }
+            if (format == ExportFormat::Csv) { writeAll(fd, EventExporter::kCsvHeader); }
+
+            threads = std::max(1u, threads);
+            const std::size_t window = 4 * std::size_t{threads};
+            std::mutex mutex;
+            std::condition_variable changed;
+            std::size_t claimed = 0, written = 0;
+            std::exception_ptr error;
+
+            const auto work = [&] {
+                std::unique_lock lock(mutex);
+                for (;;) {
+                    changed.wait(lock, [&] { return error || claimed == chunks.size() || claimed < written + window; });
+                    if (error || claimed == chunks.size()) { return; }
+                    Chunk& chunk = chunks[claimed++];
+                    lock.unlock();
+                    std::string text;
+                    try {
+                        HOCKEY_TRACE("export.format");
+                        text.reserve((chunk.end - chunk.begin + 2) * 96);
+                        EventExporter::appendEvents(text, format, *chunk.match, chunk.begin, chunk.end);
+                    } catch (...) {
+                        lock.lock();
+                        error = std::current_exception();
+                        changed.notify_all();
+                        return;
+                    }
+                    lock.lock();
+                    chunk.text = std::move(text);
+                    chunk.ready = true;
+                    changed.notify_all();
+                }
+            };
+
+            std::vector<std::thread> workers;
+            for (unsigned i = 0; i < threads; ++i) { workers.emplace_back(work); }
+            try {
+                std::unique_lock lock(mutex);
+                while (written < chunks.size()) {
+                    changed.wait(lock, [&] { return error || chunks[written].ready; });
+                    if (error) { break; }
+                    std::size_t end = written;
+                    while (end < chunks.size() && end - written < kMaxBuffersPerWrite && chunks[end].ready) { ++end; }
+                    lock.unlock();
+                    const auto buffers = std::span(chunks).subspan(written, end - written);
+                    std::vector<std::string> texts;
+                    texts.reserve(buffers.size());
+                    for (auto& chunk : buffers) { texts.push_back(std::move(chunk.text)); } // frees them as we go
+                    writeBuffers(fd, texts);
+                    lock.lock();
+                    written = end;
+                    changed.notify_all();
+                }
+            } catch (...) {
+                std::lock_guard lock(mutex);
+                if (!error) { error = std::current_exception(); }
+                changed.notify_all();
+            }
+            for (auto& worker : workers) { worker.join(); }
+            if (error) { std::rethrow_exception(error); }
+            return events;
+        }
+};
+
+// -----------------------------------------------------------------------------
+// MappedFile – read-only view of a whole file (mmap where available)
+// -----------------------------------------------------------------------------
+class MappedFile {
+    private:
+        const char* data_ = nullptr;
+        std::size_t size_ = 0;
+    #ifdef _WIN32
+        std::string fallback_; // no mmap here - read the file once instead
+    #endif
+
+    public:
+        explicit MappedFile(const std::string& path) {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0) {
+                throw std::runtime_error("cannot open " + path);
+            }
+        #ifdef _WIN32
+            char chunk[1 << 16];
+            int got = 0;
+            while ((got = ::read(fd, chunk, sizeof(chunk))) > 0) {
+                fallback_.append(chunk, static_cast<std::size_t>(got));
+            }
+            ::close(fd);
+            data_ = fallback_.data();
+            size_ = fallback_.size();
+        #else
+            struct stat info {};
+            if (::fstat(fd, &info) != 0) {
+                ::close(fd);
+                throw std::runtime_error("cannot stat " + path);
+            }
+            size_ = static_cast<std::size_t>(info.st_size);
+            if (size_ > 0) {
+                void* mapped = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped == MAP_FAILED) {
+                    ::close(fd);
+                    throw std::runtime_error("cannot map " + path);
+                }
+                ::madvise(mapped, size_, MADV_SEQUENTIAL);
+                data_ = static_cast<const char*>(mapped);
+            }
+            ::close(fd); // the mapping stays valid after close
+        #endif
+        }
+
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        ~MappedFile() {
+        #ifndef _WIN32
+            if (data_ != nullptr) {
+                ::munmap(const_cast<char*>(data_), size_);
+            }
+        #endif
+        }
+
+        std::string_view view() const noexcept { return {data_, size_}; }
+};
+
+
+// -----------------------------------------------------------------------------
+// MatchHost – runs many matches on a work-stealing pool of worker threads
+// -----------------------------------------------------------------------------
+// Each match has a strand: its own FIFO of tasks that only one worker runs at a
+// time, so actions for one HockeyMatch stay serialized and in order. Workers
+// keep ready strands in their own deque (newest first) and, when idle, steal
+// the oldest strand from another worker - a busy televised match moves as a
+// whole instead of being split across threads. A task that throws does not
+// stop its strand: the first exception of each strand is kept and rethrown by
+// drain().
+class MatchHost {
+    public:
+        using Task = std::function<void(HockeyMatch&)>;
+
+    private:
+        static constexpr int kTasksPerTurn = 64; // then the strand goes to the back of the line
+
+        struct Strand {
+            explicit Strand(HockeyMatch match) : match(std::move(match)) {}
+
+            HockeyMatch match;
+            std::mutex mutex;
+            std::deque<Task> tasks;
+            bool scheduled = false; // sitting in a deque or being run
+            std::exception_ptr error; // first task that threw, until drain() reports it
+        };
+
+        struct Worker {
+            std::mutex mutex;
+            std::deque<Strand*> ready;
+        };
+
+        std::shared_mutex registry_mutex_;
+        std::unordered_map<std::uint32_t, std::unique_ptr<Strand>> strands_;
+
+        std::vector<std::unique_ptr<Worker>> workers_;
+        std::vector<std::thread> threads_;
+        std::atomic<std::size_t> next_worker_{0};
+        std::atomic<std::size_t> ready_count_{0};   // strands waiting in any deque
+        std::atomic<std::size_t> pending_tasks_{0}; // submitted but not finished
+        std::mutex idle_mutex_;
+        std::condition_variable idle_;
+        std::condition_variable drained_;
+        bool stop_ = false; // guarded by idle_mutex_
+
+        void waitIdle() {
+            std::unique_lock lock(idle_mutex_);
+            drained_.wait(lock, [&] { return pending_tasks_.load() == 0; });
+        }
+
+        static std::size_t& currentWorker() {
+            thread_local std::size_t index = std::numeric_limits<std::size_t>::max();
+            return index;
+        }
+
+        void makeReady(Strand* strand) {
+            std::size_t target = currentWorker();
+            if (target >= workers_.size()) {
+                target = next_worker_.fetch_add(1, std::memory_order_relaxed) % workers_.size();
+            }
+            {
+                std::lock_guard lock(workers_[target]->mutex);
+                workers_[target]->ready.push_back(strand);
+            }
+            ready_count_.fetch_add(1);
+            { std::lock_guard lock(idle_mutex_); }
+            idle_.notify_one();
+        }
+
+        // Own deque from the back (hot in cache), others from the front
+        Strand* findWork(std::size_t self) {
+            {
+                Worker& mine = *workers_[self];
+                std::lock_guard lock(mine.mutex);
+                if (!mine.ready.empty()) {
+                    Strand* strand = mine.ready.back();
+                    mine.ready.pop_back();
+                    ready_count_.fetch_sub(1);
+                    return strand;
+                }
+            }
+            for (std::size_t i = 1; i < workers_.size(); ++i) {
+                Worker& victim = *workers_[(self + i) % workers_.size()];
+                std::lock_guard lock(victim.mutex);
+                if (!victim.ready.empty()) {
+                    Strand* strand = victim.ready.front();
+                    victim.ready.pop_front();
+                    ready_count_.fetch_sub(1);
+                    return strand;
+                }
+            }
+            return nullptr;
+        }
+
+        // A strand is unscheduled before its last task counts as done, so
+        // once drain() returns every strand can be remove()d
+        void runStrand(Strand& strand) {
+            Task task;
+            {
+                std::lock_guard lock(strand.mutex);
+                if (strand.tasks.empty()) {
+                    strand.scheduled = false;
+                    return;
+                }
+                task = std::move(strand.tasks.front());
+                strand.tasks.pop_front();
+            }
+            for (int done = 1;; ++done) {
+                std::exception_ptr error;
+                try {
+                    task(strand.match);
+                } catch (...) { // one bad task must not take the worker down
+                    error = std::current_exception();
+                }
+                bool more = false;
+                {
+                    std::lock_guard lock(strand.mutex);
+                    if (error && !strand.error) { strand.error = error; }
+                    more = !strand.tasks.empty();
+                    if (!more) {
+                        strand.scheduled = false;
+                    } else if (done < kTasksPerTurn) {
+                        task = std::move(strand.tasks.front());
+                        strand.tasks.pop_front();
+                    }
+                }
+                if (pending_tasks_.fetch_sub(1) == 1) {
+                    { std::lock_guard lock(idle_mutex_); }
+                    drained_.notify_all();
+                }
+                if (!more) { return; }
+                if (done == kTasksPerTurn) {
+                    makeReady(&strand); // still scheduled - let other strands have a turn
+                    return;
+                }
+            }
+        }
+
+        void workerLoop(std::size_t self) {
+            currentWorker() = self;
+            while (true) {
+                if (Strand* strand = findWork(self)) {
+                    runStrand(*strand);
+                    continue;
+                }
+                std::unique_lock lock(idle_mutex_);
+                idle_.wait(lock, [&] { return stop_ || ready_count_.load() > 0; });
+                if (stop_ && ready_count_.load() == 0) { return; }
+            }
+        }
+
+        Strand& strandFor(std::uint32_t id) {
+            std::shared_lock lock(registry_mutex_);
+            const auto it = strands_.find(id);
+            if (it == strands_.end()) {
+                throw std::out_of_range(std::format("no hosted match with id {}", id));
+            }
+            return *it->second;
+        }
+
+    public:
+        explicit MatchHost(unsigned threads = std::thread::hardware_concurrency()) {
+            threads = std::max(1u, threads);
+            for (unsigned i = 0; i < threads; ++i) {
+                workers_.push_back(std::make_unique<Worker>());
+            }
+            for (unsigned i = 0; i < threads; ++i) {
+                threads_.emplace_back(&MatchHost::workerLoop, this, i);
+            }
+        }
+
+        MatchHost(const MatchHost&) = delete;
+        MatchHost& operator=(const MatchHost&) = delete;
+
+        ~MatchHost() {
+            waitIdle();
+            {
+                std::lock_guard lock(idle_mutex_);
+                stop_ = true;
+            }
+            idle_.notify_all();
+            for (auto& thread : threads_) { thread.join(); }
+        }
+
+        // Takes ownership of a match; its id must be unique within the host
+        void add(HockeyMatch match) {
+            const std::uint32_t id = match.id();
+            std::unique_lock lock(registry_mutex_);
+            if (!strands_.try_emplace(id, std::make_unique<Strand>(std::move(match))).second) {
+                throw std::invalid_argument(std::format("match id {} is already hosted", id));
+            }
+        }
+
+        // Queues a task for the match; tasks for the same match run in submit order
+        void submit(std::uint32_t id, Task task) {
+            Strand& strand = strandFor(id);
+            pending_tasks_.fetch_add(1);
+            bool wake = false;
+            {
+                std::lock_guard lock(strand.mutex);
+                strand.tasks.push_back(std::move(task));
+                if (!strand.scheduled) {
+                    strand.scheduled = true;
+                    wake = true;
+                }
+            }
+            if (wake) { makeReady(&strand); }
+        }
+
+        // Blocks until every submitted task has run, then rethrows the first
+        // exception a task threw since the last drain() (the lowest match id's
+        // if several matches had one); the others are dropped
+        void drain() {
+            waitIdle();
+            std::exception_ptr first;
+            std::shared_lock lock(registry_mutex_);
+            std::uint32_t first_id = 0;
+            for (auto& [id, strand] : strands_) {
+                std::lock_guard strand_lock(strand->mutex);
+                if (strand->error && (!first || id < first_id)) {
+                    first = strand->error;
+                    first_id = id;
+                }
+                strand->error = nullptr;
+            }
+            lock.unlock();
+            if (first) { std::rethrow_exception(first); }
+        }
+
+        // Only safe while no tasks for the match are queued or running (e.g. after drain())
+        const HockeyMatch& match(std::uint32_t id) { return strandFor(id).match; }
+
+        // Hands the match back, e.g. to archive it once it is over. Its tasks must have run (drain() first).
+        HockeyMatch remove(std::uint32_t id) {
+            std::unique_lock lock(registry_mutex_);
+            const auto it = strands_.find(id);
+            if (it == strands_.end()) {
+                throw std::out_of_range(std::format("match id {} is not hosted", id));
+            }
+            {
+                std::lock_guard strand_lock(it->second->mutex);
+                if (it->second->scheduled) {
+                    throw std::logic_error(std::format("match id {} still has tasks", id));
+                }
+            }
+            HockeyMatch match = std::move(it->second->match);
+            strands_.erase(it);
+            return match;
+        }
+
+        std::size_t size() {
+            std::shared_lock lock(registry_mutex_);
+            return strands_.size();
+        }
+};
+
+// -----------------------------------------------------------------------------
+// ArchiveImporter – loads NDJSON/CSV match archives into HockeyMatch state
+// -----------------------------------------------------------------------------
+// Reads the format written by EventExporter (other systems can convert to it).
+// The file is split into newline-aligned chunks that are parsed on separate
+// threads; parsing never allocates per line - records point into the mapping.
+// Records are then queued to their matches in file order (runs of records for
+// the same match go through one applyBatch()) on a MatchHost, so each match is
+// built in file order and the result is identical to a single-threaded load.
+struct ImportError {
+    std::size_t line; // 1-based line number in the input file
+    std::string message;
+};
+
+struct ImportResult {
+    std::map<std::uint32_t, HockeyMatch> matches;
+    std::vector<ImportError> errors;
+    std::size_t records = 0;
+};
+
+class ArchiveImporter {
+    private:
+        // One parsed line, kept small since there is one per input line;
+        // the text points into the mapped file
+        struct Record {
+            std::string_view text;
+            std::uint32_t match = 0;
+            std::uint32_t line = 0; // chunk-local until the chunks are stitched together
+            std::uint32_t clock_ms = MatchAction::kLiveClock;
+            int quarter = 0;
+            EventKind kind = EventKind::Count;
+            Side side = Side::None;
+            CardType card = CardType::Count;
+            bool is_team = false; // "team" records carry a team name in text
+            bool text_escaped = false;
+        };
+
+        struct Chunk {
+            std::string_view data;
+            std::vector<Record> records;
+            std::vector<ImportError> errors;
+            std::size_t lines = 0;
+        };
+
+        template <typename Int>
+        static bool parseInt(std::string_view field, Int& value) {
+            const auto result = std::from_chars(field.data(), field.data() + field.size(), value);
+            return result.ec == std::errc{} && result.ptr == field.data() + field.size();
+        }
+
+        static bool parseKind(std::string_view name, Record& record) {
+            if (name == "team") { record.is_team = true; return true; }
+            for (int i = 0; i < static_cast<int>(EventKind::Count); ++i) {
+                if (eventKindName(static_cast<EventKind>(i)) == name) {
+                    record.kind = static_cast<EventKind>(i);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        static bool parseSide(std::string_view name, Side& side) {
+            if (name.empty())   { side = Side::None; return true; }
+            if (name == "home") { side = Side::Home; return true; }
+            if (name == "away") { side = Side::Away; return true; }
+            return false;
+        }
+
+        static bool parseCard(std::string_view name, CardType& card) {
+            if (name.empty()) { card = CardType::Count; return true; }
+            for (int i = 0; i < static_cast<int>(CardType::Count); ++i) {
+                if (cardName(static_cast<CardType>(i)) == name) {
+                    card = static_cast<CardType>(i);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        // Fills everything except the text from the raw field values
+        static const char* fillRecord(Record& record, std::string_view match, std::string_view quarter, std::string_view clock,
+                                      std::string_view kind, std::string_view side, std::string_view card) {
+            if (!parseInt(match, record.match))     { return "bad match id"; }
+            if (!parseInt(quarter, record.quarter)) { return "bad quarter"; }
+            if (!clock.empty() && !parseInt(clock, record.clock_ms)) { return "bad clock_ms"; }
+            if (!parseKind(kind, record))           { return "unknown kind"; }
+            if (!parseSide(side, record.side))      { return "unknown side"; }
+            if (!parseCard(card, record.card))      { return "unknown card"; }
+            return nullptr;
+        }
+
+        // match,quarter,clock_ms,kind,side,card,"text"
+        static const char* parseCsvLine(std::string_view line, Record& record) {
+            std::string_view fields[6];
+            for (auto& field : fields) {
+                const char* comma = static_cast<const char*>(std::memchr(line.data(), ',', line.size()));
+                if (comma == nullptr) { return "too few fields"; }
+                field = line.substr(0, static_cast<std::size_t>(comma - line.data()));
+                line.remove_prefix(field.size() + 1);
+            }
+            if (line.size() >= 2 && line.front() == '"' && line.back() == '"') {
+                line = line.substr(1, line.size() - 2);
+                record.text_escaped = line.find('"') != std::string_view::npos;
+            }
+            record.text = line;
+            return fillRecord(record, fields[0], fields[1], fields[2], fields[3], fields[4], fields[5]);
+        }
+
+        // {"match":1,"quarter":1,"clock_ms":5000,"kind":"goal","side":"home","card":"","text":"..."}
+        // Only the flat objects written by EventExporter are supported; clock_ms is optional.
+        static const char* parseJsonLine(std::string_view line, Record& record) {
+            std::string_view match, quarter, clock, kind, side, card;
+            bool has_text = false;
+            std::size_t pos = 1; // past '{'
+
+            while (pos < line.size() && line[pos] != '}') {
+                if (line[pos] == ',' || line[pos] == ' ') { ++pos; continue; }
+                if (line[pos] != '"') { return "expected a key"; }
+                const std::size_t key_end = line.find('"', pos + 1);
+                if (key_end == std::string_view::npos || key_end + 1 >= line.size() || line[key_end + 1] != ':') {
+                    return "malformed key";
+                }
+                const std::string_view key = line.substr(pos + 1, key_end - pos - 1);
+                pos = key_end + 2;
+
+                std::string_view value;
+                bool escaped = false;
+                if (pos < line.size() && line[pos] == '"') {
+                    std::size_t end = pos + 1;
+                    while (end < line.size() && line[end] != '"') {
+                        if (line[end] == '\\') { escaped = true; ++end; }
+                        ++end;
+                    }
+                    if (end >= line.size()) { return "unterminated string"; }
+                    value = line.substr(pos + 1, end - pos - 1);
+                    pos = end + 1;
+                } else {
+                    const std::size_t end = line.find_first_of(",}", pos);
+                    if (end == std::string_view::npos) { return "unterminated value"; }
+                    value = line.substr(pos, end - pos);
+                    pos = end;
+                }
+
+                if (key == "match")         { match = value; }
+                else if (key == "quarter")  { quarter = value; }
+                else if (key == "clock_ms") { clock = value; }
+                else if (key == "kind")     { kind = value; }
+                else if (key == "side")     { side = value; }
+                else if (key == "card")     { card = value; }
+                else if (key == "text")     { record.text = value; record.text_escaped = escaped; has_text = true; }
+            }
+            if (pos >= line.size()) { return "missing closing brace"; }
+            if (!has_text) { return "missing text"; }
+            return fillRecord(record, match, quarter, clock, kind, side, card);
+        }
+
+        static void parseChunk(Chunk& chunk, bool json) {
+            HOCKEY_TRACE("import.parseChunk");
+            chunk.records.reserve(chunk.data.size() / 32); // lines are rarely shorter than that
+            std::string_view rest = chunk.data;
+            while (!rest.empty()) {
+                const char* newline = static_cast<const char*>(std::memchr(rest.data(), '\n', rest.size()));
+                const std::size_t length = newline ? static_cast<std::size_t>(newline - rest.data()) : rest.size();
+                std::string_view line = rest.substr(0, length);
+                rest.remove_prefix(newline ? length + 1 : length);
+                ++chunk.lines;
+
+                if (!line.empty() && line.back() == '\r') { line.remove_suffix(1); }
+                if (line.empty()) { continue; }
+                if (!json && line.starts_with("match,")) { continue; } // CSV header
+
+                Record record;
+                record.line = static_cast<std::uint32_t>(chunk.lines);
+                const char* error = json ? (line.front() == '{' ? parseJsonLine(line, record) : "expected '{'")
+                                         : parseCsvLine(line, record);
+                if (error != nullptr) {
+                    chunk.errors.push_back({chunk.lines, error});
+                } else {
+                    chunk.records.push_back(record);
+                }
+            }
+        }
+
+        // Team names are the only text we keep, so only they get unescaped.
+        // \uXXXX (EventExporter writes control characters that way) becomes UTF-8.
+        static std::string unescape(const Record& record, bool json) {
+            if (!record.text_escaped) { return std::string(record.text); }
+            const std::string_view text = record.text;
+            std::string out;
+            out.reserve(text.size());
+            const auto hex4 = [&](std::size_t at, std::uint32_t& value) {
+                return at + 4 <= text.size() && parseHex(text.substr(at, 4), value);
+            };
+            for (std::size_t i = 0; i < text.size(); ++i) {
+                const char c = text[i];
+                if (json && c == '\\' && i + 1 < text.size()) {
+                    const char next = text[++i];
+                    std::uint32_t code = 0;
+                    if (next != 'u' || !hex4(i + 1, code)) {
+                        out += (next == 'n') ? '\n' : (next == 't') ? '\t' : (next == 'r') ? '\r'
+                             : (next == 'b') ? '\b' : (next == 'f') ? '\f' : next;
+                        continue;
+                    }
+                    i += 4;
+                    std::uint32_t low = 0;
+                    if (code >= 0xD800 && code < 0xDC00 && i + 2 < text.size() && text[i + 1] == '\\' &&
+                        text[i + 2] == 'u' && hex4(i + 3, low) && low >= 0xDC00 && low < 0xE000) {
+                        code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00); // surrogate pair
+                        i += 6;
+                    }
+                    appendUtf8(out, code);
+                } else if (!json && c == '"' && i + 1 < text.size() && text[i + 1] == '"') {
+                    out += '"';
+                    ++i;
+                } else {
+                    out += c;
+                }
+            }
+            return out;
+        }
+
+        static bool parseHex(std::string_view digits, std::uint32_t& value) {
+            const auto result = std::from_chars(digits.data(), digits.data() + digits.size(), value, 16);
+            return result.ec == std::errc{} && result.ptr == digits.data() + digits.size();
+        }
+
+        static void appendUtf8(std::string& out, std::uint32_t code) {
+            if (code < 0x80) {
+                out += static_cast<char>(code);
+            } else if (code < 0x800) {
+                out += static_cast<char>(0xC0 | (code >> 6));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else if (code < 0x10000) {
+                out += static_cast<char>(0xE0 | (code >> 12));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            } else {
+                out += static_cast<char>(0xF0 | (code >> 18));
+                out += static_cast<char>(0x80 | ((code >> 12) & 0x3F));
+                out += static_cast<char>(0x80 | ((code >> 6) & 0x3F));
+                out += static_cast<char>(0x80 | (code & 0x3F));
+            }
+        }
+
+        // Consecutive records for one match, applied with a single applyBatch()
+        // on the match's MatchHost strand
+        struct PendingBatch {
+            std::uint32_t match = 0;
+            bool open = false;
+            int quarter = 0; // quarter the next record must be in
+            bool finished = false; // Q4 has ended: nothing more may follow
+            std::vector<MatchAction> actions;
+            std::vector<std::size_t> lines; // input line of each action
+        };
+
+        // Where a match stands after the records queued for it so far
+        struct Progress {
+            int quarter = 1;
+            bool finished = false;
+        };
+
+        // Errors found on the host's threads, merged into the result at the end
+        struct SharedErrors {
+            std::mutex mutex;
+            std::vector<ImportError> errors;
+        };
+
+        static void flushBatch(PendingBatch& batch, MatchHost& host, SharedErrors& shared,
+                               std::unordered_map<std::uint32_t, Progress>& progress) {
+            if (!batch.open) { return; }
+            progress[batch.match] = {batch.quarter, batch.finished};
+            batch.open = false;
+            if (batch.actions.empty()) { return; }
+            host.submit(batch.match, [actions = std::move(batch.actions), lines = std::move(batch.lines),
+                                      &shared](HockeyMatch& match) {
+                const auto results = match.applyBatch(actions);
+                for (std::size_t i = 0; i < results.size(); ++i) {
+                    if (results[i] != ActionResult::Applied) {
+                        std::lock_guard lock(shared.mutex);
+                        shared.errors.push_back({lines[i], std::format("match {}: {}", match.id(),
+                                                                       actionResultName(results[i]))});
+                    }
+                }
+            });
+            batch.actions = {};
+            batch.lines = {};
+        }
+
+        // Checks the record against the batch's running quarter and queues its action
+        static const char* queueRecord(PendingBatch& batch, const Record& record, std::size_t line) {
+            if (batch.finished) {
+                return "event after the end of the match";
+            }
+            if (record.quarter != batch.quarter) {
+                return "event quarter does not match the match state";
+            }
+            MatchAction action{ActionKind::Goal, record.side, record.card, record.clock_ms};
+            switch (record.kind) {
+                case EventKind::QuarterStart:
+                    return nullptr; // implied by the previous quarter_end (or by the match itself for Q1)
+                case EventKind::QuarterEnd:
+                    action.kind = ActionKind::NextQuarter;
+                    batch.finished = batch.quarter == TOTAL_QUARTERS;
+                    batch.quarter = std::min(batch.quarter + 1, TOTAL_QUARTERS);
+                    break;
+                case EventKind::Goal:          action.kind = ActionKind::Goal; break;
+                case EventKind::Card:          action.kind = ActionKind::Card; break;
+                case EventKind::PenaltyCorner: action.kind = ActionKind::PenaltyCorner; break;
+                case EventKind::Count:         return "unknown kind";
+            }
+            batch.actions.push_back(action);
+            batch.lines.push_back(line);
+            return nullptr;
+        }
+
+    public:
+        static ImportResult importFile(const std::string& path, unsigned threads = std::thread::hardware_concurrency()) {
+            const MappedFile file(path);
+            const std::string_view data = file.view();
+            const std::size_t first = data.find_first_not_of(" \t\r\n");
+            const bool json = first != std::string_view::npos && data[first] == '{';
+
+            // Split at newlines into roughly equal chunks, at least 1 MiB each
+            constexpr std::size_t kMinChunk = std::size_t{1} << 20;
+            threads = std::max(1u, threads);
+            const std::size_t target = std::max(kMinChunk, data.size() / threads + 1);
+            std::vector<Chunk> chunks;
+            std::size_t begin = 0;
+            while (begin < data.size()) {
+                std::size_t end = std::min(data.size(), begin + target);
+                if (end < data.size()) {
+                    const char* newline = static_cast<const char*>(std::memchr(data.data() + end, '\n', data.size() - end));
+                    end = newline ? static_cast<std::size_t>(newline - data.data()) + 1 : data.size();
+                }
+                chunks.push_back({data.substr(begin, end - begin), {}, {}, 0});
+                begin = end;
+            }
+
+            {
+                std::vector<std::thread> workers;
+                for (std::size_t i = 1; i < chunks.size(); ++i) {
+                    workers.emplace_back(parseChunk, std::ref(chunks[i]), json);
+                }
+                if (!chunks.empty()) { parseChunk(chunks[0], json); }
+                for (auto& worker : workers) { worker.join(); }
+            }
+
+            // Queue in file order - per-match ordering is what the archive says.
+            // Each match's batches run in that order on its strand, so different
+            // matches are applied in parallel with the same result.
+            HOCKEY_TRACE("import.apply");
+            ImportResult result;
+            MatchHost host(threads);
+            SharedErrors shared;
+            std::unordered_map<std::uint32_t, Progress> progress;
+            std::unordered_map<std::uint32_t, std::pair<std::string, std::string>> team_names;
+            PendingBatch batch;
+            std::size_t line_offset = 0;
+            for (auto& chunk : chunks) {
+                for (auto& error : chunk.errors) {
+                    error.line += line_offset;
+                    result.errors.push_back(std::move(error));
+                }
+                for (const auto& record : chunk.records) {
+                    const std::size_t line = record.line + line_offset;
+                    ++result.records;
+
+                    if (record.is_team) {
+                        auto& names = team_names[record.match];
+                        (record.side == Side::Away ? names.second : names.first) = unescape(record, json);
+                        continue;
+                    }
+
+                    if (!batch.open || batch.match != record.match) {
+                        flushBatch(batch, host, shared, progress);
+                        const auto [it, added] = progress.try_emplace(record.match);
+                        if (added) {
+                            auto& names = team_names[record.match];
+                            if (names.first.empty())  { names.first = "Home"; }
+                            if (names.second.empty()) { names.second = "Away"; }
+                            host.add(HockeyMatch(std::move(names.first), std::move(names.second), record.match));
+                        }
+                        batch.match = record.match;
+                        batch.open = true;
+                        batch.quarter = it->second.quarter;
+                        batch.finished = it->second.finished;
+                    }
+                    if (const char* error = queueRecord(batch, record, line)) {
+                        result.errors.push_back({line, std::format("match {}: {}", record.match, error)});
+                    }
+                }
+                line_offset += chunk.lines;
+            }
+            flushBatch(batch, host, shared, progress);
+            host.drain();
+            for (const auto& [id, done] : progress) { result.matches.emplace(id, host.remove(id)); }
+            result.errors.insert(result.errors.end(), shared.errors.begin(), shared.errors.end());
+
+            std::stable_sort(result.errors.begin(), result.errors.end(),
+                             [](const ImportError& a, const ImportError& b) { return a.line < b.line; });
+            return result;
+        }
+};
+
+// -----------------------------------------------------------------------------
+// SharedScoreboard – live match state in POSIX shared memory for other processes
+// -----------------------------------------------------------------------------
+// Fixed, versioned layout: a header followed by one 64-byte-aligned slot per
+// match. A slot's sequence is odd while it is being written; readers copy the
+// slot and retry if the sequence was odd or changed (see readSlot()). A reader
+// polling an unchanged match touches a single cache line and makes no syscalls.
+#ifndef _WIN32
+namespace shm {
+
+inline constexpr char kMagic[8] = {'H', 'O', 'C', 'K', 'E', 'Y', 'S', 'B'};
+inline constexpr std::uint32_t kLayoutVersion = 1;
+inline constexpr std::size_t kNameSize = 32;   // NUL-terminated, truncated if longer
+inline constexpr std::size_t kRecentEvents = 16;
+
+struct Event {
+    std::uint32_t clock_ms;
+    std::uint8_t quarter;
+    std::uint8_t kind;  // EventKind
+    std::uint8_t side;  // Side
+    std::uint8_t card;  // CardType, only for cards
+};
+
+struct Counters {
+    std::int32_t goals, green, yellow, red, penalty_corners;
+};
+
+struct alignas(64) Slot {
+    std::atomic<std::uint32_t> sequence;
+    std::uint32_t match_id;
+    std::uint32_t in_use;
+    std::int32_t quarter;
+    std::uint32_t finished;
+    std::uint32_t clock_ms;            // match time of the latest event
+    std::int64_t kick_off_steady_ns;   // steady_clock (CLOCK_MONOTONIC) at kick-off, for a live clock
+    Counters home, away;
+    std::uint64_t events_total;        // recent[(events_total - 1) % kRecentEvents] is the newest
+    char home_name[kNameSize];
+    char away_name[kNameSize];
+    Event recent[kRecentEvents];
+};
+
+struct alignas(64) Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t header_size;
+    std::uint32_t slot_size;
+    std::uint32_t slot_count;
+    std::uint32_t recent_events;
+};
+
+static_assert(std::atomic<std::uint32_t>::is_always_lock_free, "slot sequence must work across processes");
+
+// Consistent copy of one slot; false if the slot is unused
+inline bool readSlot(const Slot& slot, Slot& out) {
+    std::uint32_t before = 0, after = 0;
+    do {
+        before = slot.sequence.load(std::memory_order_acquire);
+        std::memcpy(static_cast<void*>(&out), static_cast<const void*>(&slot), sizeof(Slot));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        after = slot.sequence.load(std::memory_order_relaxed);
+    } while ((before & 1) != 0 || before != after);
+    return out.in_use != 0;
+}
+
+} // namespace shm
+
+class SharedScoreboard : public MatchObserver {
+    private:
+        std::string name_;
+        std::size_t size_ = 0;
+        shm::Header* header_ = nullptr;
+        shm::Slot* slots_ = nullptr;
+        // Hosted matches publish from their own threads; attach and detach change the map
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<std::uint32_t, shm::Slot*> slot_of_match_;
+
+        static void copyName(char (&dest)[shm::kNameSize], const std::string& name) {
+            const std::size_t n = std::min(name.size(), shm::kNameSize - 1);
+            std::memcpy(dest, name.data(), n);
+            dest[n] = '\0';
+        }
+
+        static shm::Counters toShm(const TeamCounters& c) {
+            return {c.goals, c.green, c.yellow, c.red, c.penalty_corners};
+        }
+
+        // Writer side of the slot's sequence lock
+        template <typename Fn>
+        static void update(shm::Slot& slot, Fn&& fn) {
+            const std::uint32_t sequence = slot.sequence.load(std::memory_order_relaxed);
+            slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            fn(slot);
+            slot.sequence.store(sequence + 2, std::memory_order_release);
+        }
+
+        static void writeState(shm::Slot& slot, const HockeyMatch& match) {
+            const ScoreboardState state = match.state();
+            slot.quarter = state.quarter;
+            slot.finished = match.finished() ? 1 : 0;
+            slot.home = toShm(state.home);
+            slot.away = toShm(state.away);
+        }
+
+        static void writeEvent(shm::Slot& slot, const MatchEvent& event) {
+            slot.recent[slot.events_total % shm::kRecentEvents] = {
+                event.clockMs(), static_cast<std::uint8_t>(event.quarter()), static_cast<std::uint8_t>(event.kind()),
+                static_cast<std::uint8_t>(event.side()), static_cast<std::uint8_t>(event.card())};
+            ++slot.events_total;
+            slot.clock_ms = event.clockMs();
+        }
+
+    public:
+        // Creates (or replaces) the segment /name with room for `slot_count` matches
+        SharedScoreboard(std::string name, std::uint32_t slot_count) : name_(std::move(name)) {
+            if (name_.empty() || name_.front() != '/') { name_.insert(name_.begin(), '/'); }
+            size_ = sizeof(shm::Header) + sizeof(shm::Slot) * slot_count;
+
+            const int fd = ::shm_open(name_.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+            if (fd < 0) {
+                throw std::runtime_error("shm_open failed for " + name_);
+            }
+            if (::ftruncate(fd, static_cast<off_t>(size_)) != 0) {
+                ::close(fd);
+                ::shm_unlink(name_.c_str());
+                throw std::runtime_error("cannot size shared memory " + name_);
+            }
+            void* mapped = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            ::close(fd);
+            if (mapped == MAP_FAILED) {
+                ::shm_unlink(name_.c_str());
+                throw std::runtime_error("cannot map shared memory " + name_);
+            }
+
+            // Fresh pages are zeroed: every slot starts unused with sequence 0
+            header_ = static_cast<shm::Header*>(mapped);
+            slots_ = reinterpret_cast<shm::Slot*>(static_cast<char*>(mapped) + sizeof(shm::Header));
+            header_->version = shm::kLayoutVersion;
+            header_->header_size = sizeof(shm::Header);
+            header_->slot_size = sizeof(shm::Slot);
+            header_->slot_count = slot_count;
+            header_->recent_events = shm::kRecentEvents;
+            std::atomic_thread_fence(std::memory_order_release);
+            std::memcpy(header_->magic, shm::kMagic, sizeof(shm::kMagic)); // written last: marks the header valid
+        }
+
+        SharedScoreboard(const SharedScoreboard&) = delete;
+        SharedScoreboard& operator=(const SharedScoreboard&) = delete;
+
+        ~SharedScoreboard() override {
+            ::munmap(header_, size_);
+            ::shm_unlink(name_.c_str());
+        }
+
+        // Gives the match a slot, publishes its current state and follows it from now on
+        // Slots given up by detach() are reused.
+        void attach(HockeyMatch& match) {
+            std::unique_lock lock(mutex_);
+            shm::Slot* const end = slots_ + header_->slot_count;
+            shm::Slot* const free = std::find_if(slots_, end, [](const shm::Slot& s) { return s.in_use == 0; });
+            if (free == end) {
+                throw std::runtime_error("no free shared scoreboard slot");
+            }
+            shm::Slot& slot = *free;
+            update(slot, [&](shm::Slot& s) {
+                s.match_id = match.id();
+                s.in_use = 1;
+                s.events_total = 0;
+                s.kick_off_steady_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                    match.kickOff().time_since_epoch()).count();
+                copyName(s.home_name, match.home().name());
+                copyName(s.away_name, match.away().name());
+                writeState(s, match);
+                for (const auto& event : match.events()) { writeEvent(s, event); }
+            });
+            slot_of_match_[match.id()] = &slot;
+            lock.unlock();
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) {
+            match.removeObserver(*this);
+            std::unique_lock lock(mutex_);
+            const auto it = slot_of_match_.find(match.id());
+            if (it == slot_of_match_.end()) { return; }
+            update(*it->second, [](shm::Slot& s) { s.in_use = 0; });
+            slot_of_match_.erase(it);
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            std::shared_lock lock(mutex_); // the slot itself is only written by the match's thread
+            const auto it = slot_of_match_.find(match.id());
+            if (it == slot_of_match_.end()) { return; }
+            update(*it->second, [&](shm::Slot& s) {
+                writeState(s, match);
+                writeEvent(s, event);
+            });
+        }
+};
+#endif
+
+// -----------------------------------------------------------------------------
+// Replication – stream every match event from a primary to standby processes
+// -----------------------------------------------------------------------------
+// Addresses are "unix:/path/to/socket" or "host:port" (TCP). The primary keeps
+// log blocks only until every standby has acked them. Trimmed blocks are folded
+// into one snapshot per unfinished match, so a standby that connects late first
+// gets those snapshots, renumbered to end right before the oldest kept block,
+// and then the kept blocks. Records are pipelined: the primary never waits for
+// acks; each standby acks the highest sequence it has applied.
+// Records use the native byte order - both ends run on the same kind of machine.
+#ifndef _WIN32
+namespace replication {
+
+enum class RecordType : std::uint8_t { OpenMatch = 0, Event = 1 };
+
+// Fixed part of every record; OpenMatch is followed by the two team names
+struct RecordHeader {
+    std::uint64_t sequence;
+    std::uint32_t match_id;
+    std::uint32_t clock_ms;
+    RecordType type;
+    std::uint8_t kind; // EventKind
+    std::uint8_t side; // Side
+    std::uint8_t card; // CardType
+    std::uint16_t home_length;
+    std::uint16_t away_length;
+};
+static_assert(sizeof(RecordHeader) == 24);
+
+inline int openSocket(const std::string& address, bool listening) {
+    int fd = -1;
+    if (address.starts_with("unix:")) {
+        const std::string path = address.substr(5);
+        sockaddr_un addr{};
+        if (path.size() >= sizeof(addr.sun_path)) { throw std::invalid_argument("socket path too long: " + path); }
+        addr.sun_family = AF_UNIX;
+        std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listening) { ::unlink(path.c_str()); }
+        const int rc = listening ? ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+                                 : ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (fd < 0 || rc != 0) {
+            if (fd >= 0) { ::close(fd); }
+            throw std::runtime_error("cannot " + std::string(listening ? "listen on " : "connect to ") + address);
+        }
+    } else {
+        const std::size_t colon = address.rfind(':');
+        std::uint16_t port = 0;
+        if (colon == std::string::npos || std::from_chars(address.data() + colon + 1,
+                address.data() + address.size(), port).ec != std::errc{}) {
+            throw std::invalid_argument("expected unix:/path or host:port, got " + address);
+        }
+        sockaddr_in addr{};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        if (::inet_pton(AF_INET, address.substr(0, colon).c_str(), &addr.sin_addr) != 1) {
+            throw std::invalid_argument("expected an IPv4 address in " + address);
+        }
+        fd = ::socket(AF_INET, SOCK_STREAM, 0);
+        const int one = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+        if (listening) { ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one)); }
+        const int rc = listening ? ::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr))
+                                 : ::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+        if (fd < 0 || rc != 0) {
+            if (fd >= 0) { ::close(fd); }
+            throw std::runtime_error("cannot " + std::string(listening ? "listen on " : "connect to ") + address);
+        }
+    }
+    if (listening && ::listen(fd, 16) != 0) {
+        ::close(fd);
+        throw std::runtime_error("cannot listen on " + address);
+    }
+    return fd;
+}
+
+} // namespace replication
+
+class ReplicationPrimary : public MatchObserver {
+    private:
+        static constexpr std::size_t kBlockSize = std::size_t{1} << 16;
+
+        // Log storage that never moves, so the sender can read without the lock
+        struct Block {
+            std::array<char, kBlockSize> bytes;
+            std::size_t used = 0;
+            std::uint64_t last_sequence = 0;
+        };
+
+        struct Standby {
+            int fd = -1;
+            std::uint64_t block = 0;  // absolute block number (first_block_ is the oldest kept)
+            std::size_t offset = 0;   // next byte to send in it
+            std::string snapshot;     // late joiners: what was trimmed, sent before the blocks
+            std::size_t snapshot_sent = 0;
+            std::uint64_t acked = 0;
+            std::array<char, 64> ack_buffer{};
+            std::size_t ack_bytes = 0;
+        };
+
+        // Records of trimmed blocks, per match, for standbys that join later.
+        // A match is dropped once its final whistle is trimmed, so this holds
+        // the unfinished matches only.
+        struct MatchSnapshot {
+            std::string records;
+            std::size_t count = 0;
+            int quarter_ends = 0;
+        };
+
+        int listen_fd_;
+        std::mutex mutex_; // guards blocks_, first_block_, snapshots_, trimmed_through_, sequence_ and stop_
+        std::condition_variable wake_;
+        std::deque<std::unique_ptr<Block>> blocks_;
+        std::uint64_t first_block_ = 0;
+        std::map<std::uint32_t, MatchSnapshot> snapshots_;
+        std::uint64_t trimmed_through_ = 0; // highest sequence no longer in blocks_
+        std::uint64_t sequence_ = 0;
+        bool stop_ = false;
+        std::vector<Standby> standbys_; // sender thread only
+        std::atomic<std::uint64_t> min_acked_{0};
+        std::thread sender_;
+
+        void append(replication::RecordHeader header, std::string_view home = {}, std::string_view away = {}) {
+            std::lock_guard lock(mutex_);
+            header.sequence = ++sequence_;
+            header.home_length = static_cast<std::uint16_t>(home.size());
+            header.away_length = static_cast<std::uint16_t>(away.size());
+            const std::size_t size = sizeof(header) + home.size() + away.size();
+            if (size > kBlockSize) { throw std::length_error("team names too long to replicate"); }
+            if (blocks_.empty() || blocks_.back()->used + size > kBlockSize) {
+                blocks_.push_back(std::make_unique<Block>());
+            }
+            Block& block = *blocks_.back();
+            std::memcpy(block.bytes.data() + block.used, &header, sizeof(header));
+            home.copy(block.bytes.data() + block.used + sizeof(header), home.size());
+            away.copy(block.bytes.data() + block.used + sizeof(header) + home.size(), away.size());
+            block.used += size;
+            block.last_sequence = header.sequence;
+            wake_.notify_one();
+        }
+
+        static replication::RecordHeader eventRecord(std::uint32_t match_id, const MatchEvent& event) {
+            return {0, match_id, event.clockMs(), replication::RecordType::Event,
+                    static_cast<std::uint8_t>(event.kind()), static_cast<std::uint8_t>(event.side()),
+                    static_cast<std::uint8_t>(event.card()), 0, 0};
+        }
+
+        // Drops the blocks every standby has acked, folding their records into
+        // the per-match snapshots. The block being appended to always stays.
+        void trim(std::uint64_t acked) {
+            std::lock_guard lock(mutex_);
+            while (blocks_.size() > 1 && blocks_.front()->last_sequence <= acked) {
+                const Block& block = *blocks_.front();
+                for (std::size_t at = 0; at < block.used;) {
+                    replication::RecordHeader header;
+                    std::memcpy(&header, block.bytes.data() + at, sizeof(header));
+                    const std::size_t size = sizeof(header) + header.home_length + header.away_length;
+                    MatchSnapshot& snapshot = snapshots_[header.match_id];
+                    if (header.type == replication::RecordType::Event &&
+                        header.kind == static_cast<std::uint8_t>(EventKind::QuarterEnd) &&
+                        ++snapshot.quarter_ends >= TOTAL_QUARTERS) {
+                        snapshots_.erase(header.match_id); // over: nothing after this refers to it
+                    } else {
+                        snapshot.records.append(block.bytes.data() + at, size);
+                        ++snapshot.count;
+                    }
+                    at += size;
+                }
+                trimmed_through_ = block.last_sequence;
+                blocks_.pop_front();
+                ++first_block_;
+            }
+        }
+
+        // A new standby gets the snapshots, renumbered to end right before the
+        // first kept record, then the blocks. Caller holds mutex_.
+        Standby joinLocked(int fd) const {
+            Standby standby;
+            standby.fd = fd;
+            standby.block = first_block_;
+            std::size_t count = 0;
+            for (const auto& [match_id, snapshot] : snapshots_) { count += snapshot.count; }
+            std::uint64_t sequence = trimmed_through_ - count;
+            for (const auto& [match_id, snapshot] : snapshots_) {
+                const std::size_t base = standby.snapshot.size();
+                standby.snapshot += snapshot.records;
+                for (std::size_t at = base; at < standby.snapshot.size();) {
+                    replication::RecordHeader header;
+                    std::memcpy(&header, standby.snapshot.data() + at, sizeof(header));
+                    header.sequence = ++sequence;
+                    std::memcpy(standby.snapshot.data() + at, &header, sizeof(header));
+                    at += sizeof(header) + header.home_length + header.away_length;
+                }
+            }
+            return standby;
+        }
+
+        // Sends whatever this standby has not seen yet; false if it went away
+        bool sendPending(Standby& standby) {
+            while (standby.snapshot_sent < standby.snapshot.size()) {
+                const auto sent = ::send(standby.fd, standby.snapshot.data() + standby.snapshot_sent,
+                                         standby.snapshot.size() - standby.snapshot_sent, 0);
+                if (sent <= 0) {
+                    if (sent < 0 && errno == EINTR) { continue; }
+                    return false;
+                }
+                standby.snapshot_sent += static_cast<std::size_t>(sent);
+            }
+            if (!standby.snapshot.empty()) { std::string().swap(standby.snapshot); }
+
+            while (true) {
+                const Block* block = nullptr;
+                std::size_t used = 0;
+                {
+                    std::lock_guard lock(mutex_);
+                    if (standby.block < first_block_) { // trimmed, so it was sent and acked in full
+                        standby.block = first_block_;
+                        standby.offset = 0;
+                    }
+                    const std::uint64_t index = standby.block - first_block_;
+                    if (index >= blocks_.size()) { return true; }
+                    block = blocks_[index].get();
+                    used = block->used;
+                    if (standby.offset == used) {
+                        if (index + 1 == blocks_.size()) { return true; }
+                        ++standby.block;
+                        standby.offset = 0;
+                        continue;
+                    }
+                }
+                const auto sent = ::send(standby.fd, block->bytes.data() + standby.offset, used - standby.offset, 0);
+                if (sent <= 0) {
+                    if (sent < 0 && errno == EINTR) { continue; }
+                    return false;
+                }
+                standby.offset += static_cast<std::size_t>(sent);
+            }
+        }
+
+        // Acks are 8-byte sequence numbers; only the latest one matters
+        bool readAcks(Standby& standby) {
+            while (true) {
+                const auto got = ::recv(standby.fd, standby.ack_buffer.data() + standby.ack_bytes,
+                                        standby.ack_buffer.size() - standby.ack_bytes, MSG_DONTWAIT);
+                if (got == 0) { return false; }
+                if (got < 0) { return errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR; }
+                standby.ack_bytes += static_cast<std::size_t>(got);
+                const std::size_t whole = standby.ack_bytes / sizeof(std::uint64_t);
+                if (whole > 0) {
+                    std::memcpy(&standby.acked, standby.ack_buffer.data() + (whole - 1) * sizeof(std::uint64_t),
+                                sizeof(std::uint64_t));
+                    const std::size_t rest = standby.ack_bytes - whole * sizeof(std::uint64_t);
+                    std::memmove(standby.ack_buffer.data(), standby.ack_buffer.data() + whole * sizeof(std::uint64_t), rest);
+                    standby.ack_bytes = rest;
+                }
+            }
+        }
+
+        void run() {
+            std::uint64_t seen = 0; // sequence_ when we last looked
+            while (true) {
+                {
+                    // New records wake us at once, even if they were appended while
+                    // we were sending; the timeout picks up new standbys and acks
+                    std::unique_lock lock(mutex_);
+                    wake_.wait_for(lock, std::chrono::milliseconds(1), [&] { return stop_ || sequence_ != seen; });
+                    if (stop_) { break; }
+                    seen = sequence_;
+                }
+                while (true) { // new standbys
+                    const int fd = ::accept(listen_fd_, nullptr, nullptr);
+                    if (fd < 0) { break; }
+                    std::lock_guard lock(mutex_);
+                    standbys_.push_back(joinLocked(fd));
+                }
+                std::uint64_t min_acked = std::numeric_limits<std::uint64_t>::max();
+                std::erase_if(standbys_, [&](Standby& standby) {
+                    if (!sendPending(standby) || !readAcks(standby)) {
+                        ::close(standby.fd);
+                        return true;
+                    }
+                    min_acked = std::min(min_acked, standby.acked);
+                    return false;
+                });
+                min_acked_.store(standbys_.empty() ? 0 : min_acked);
+                trim(min_acked); // no standbys: everything but the open block goes to the snapshots
+            }
+            for (const auto& standby : standbys_) { ::close(standby.fd); }
+        }
+
+    public:
+        explicit ReplicationPrimary(const std::string& address) : listen_fd_(replication::openSocket(address, true)) {
+            std::signal(SIGPIPE, SIG_IGN); // a vanished standby must not kill the primary
+            ::fcntl(listen_fd_, F_SETFL, ::fcntl(listen_fd_, F_GETFL) | O_NONBLOCK);
+            sender_ = std::thread(&ReplicationPrimary::run, this);
+        }
+
+        ReplicationPrimary(const ReplicationPrimary&) = delete;
+        ReplicationPrimary& operator=(const ReplicationPrimary&) = delete;
+
+        ~ReplicationPrimary() override {
+            {
+                std::lock_guard lock(mutex_);
+                stop_ = true;
+            }
+            wake_.notify_one();
+            sender_.join();
+            ::close(listen_fd_);
+        }
+
+        // Replicates the match from its current state on
+        void attach(HockeyMatch& match) {
+            append({0, match.id(), 0, replication::RecordType::OpenMatch, 0, 0, 0, 0, 0},
+                   match.home().name(), match.away().name());
+            for (const auto& event : match.events()) {
+                append(eventRecord(match.id(), event));
+            }
+            match.addObserver(*this);
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            append(eventRecord(match.id(), event));
+        }
+
+        std::uint64_t lastSequence() {
+            std::lock_guard lock(mutex_);
+            return sequence_;
+        }
+
+        // Highest sequence every connected standby has applied (0 without standbys)
+        std::uint64_t ackedByAll() const noexcept { return min_acked_.load(); }
+
+        // Log blocks still held (the rest was acked by everyone and trimmed)
+        std::size_t retainedBlocks() {
+            std::lock_guard lock(mutex_);
+            return blocks_.size();
+        }
+};
+
+// Follows a primary and keeps its own copy of every replicated match.
+// When the primary goes away, takeOver() hands the copies to the caller.
+class ReplicationStandby {
+    private:
+        int fd_;
+        std::mutex mutex_; // guards matches_
+        std::map<std::uint32_t, HockeyMatch> matches_;
+        std::atomic<std::uint64_t> applied_{0};
+        std::atomic<bool> connected_{true};
+        std::string error_;
+        std::thread receiver_;
+
+        // Applies every complete record in `bytes`; returns how many bytes it used
+        std::size_t applyRecords(std::string_view bytes) {
+            std::size_t used = 0;
+            std::uint64_t applied = applied_.load();
+            std::vector<MatchAction> actions;
+            HockeyMatch* batch_match = nullptr;
+
+            const auto flush = [&] {
+                if (batch_match != nullptr && !actions.empty()) { batch_match->applyBatch(actions); }
+                actions.clear();
+            };
+
+            std::lock_guard lock(mutex_);
+            while (bytes.size() - used >= sizeof(replication::RecordHeader)) {
+                replication::RecordHeader header;
+                std::memcpy(&header, bytes.data() + used, sizeof(header));
+                const std::size_t size = sizeof(header) + header.home_length + header.away_length;
+                if (bytes.size() - used < size) { break; }
+                // A fresh standby starts wherever the primary's snapshot starts
+                if (header.sequence != applied + 1 && applied != 0) {
+                    throw std::runtime_error(std::format("replication gap: expected {}, got {}", applied + 1, header.sequence));
+                }
+
+                if (header.type == replication::RecordType::OpenMatch) {
+                    flush();
+                    const char* names = bytes.data() + used + sizeof(header);
+                    matches_.try_emplace(header.match_id, std::string(names, header.home_length),
+                                         std::string(names + header.home_length, header.away_length), header.match_id);
+                } else {
+                    const auto it = matches_.find(header.match_id);
+                    if (it == matches_.end()) {
+                        throw std::runtime_error(std::format("event for unknown match {}", header.match_id));
+                    }
+                    if (&it->second != batch_match) {
+                        flush();
+                        batch_match = &it->second;
+                    }
+                    if (const auto action = replayAction(header.kind, header.side, header.card, header.clock_ms)) {
+                        actions.push_back(*action);
+                    }
+                }
+                applied = header.sequence;
+                used += size;
+            }
+            flush();
+            applied_.store(applied);
+            return used;
+        }
+
+        void run() {
+            std::string buffer;
+            std::array<char, 1 << 16> chunk;
+            try {
+                while (true) {
+                    const auto got = ::recv(fd_, chunk.data(), chunk.size(), 0);
+                    if (got < 0 && errno == EINTR) { continue; }
+                    if (got <= 0) { break; }
+                    buffer.append(chunk.data(), static_cast<std::size_t>(got));
+                    buffer.erase(0, applyRecords(buffer));
+
+                    const std::uint64_t ack = applied_.load();
+                    if (::send(fd_, &ack, sizeof(ack), 0) != static_cast<ssize_t>(sizeof(ack))) { break; }
+                }
+            } catch (const std::exception& e) {
+                error_ = e.what();
+            }
+            connected_.store(false);
+        }
+
+    public:
+        explicit ReplicationStandby(const std::string& address) : fd_(replication::openSocket(address, false)) {
+            std::signal(SIGPIPE, SIG_IGN);
+            receiver_ = std::thread(&ReplicationStandby::run, this);
+        }
+
+        ReplicationStandby(const ReplicationStandby&) = delete;
+        ReplicationStandby& operator=(const ReplicationStandby&) = delete;
+
+        ~ReplicationStandby() {
+            ::shutdown(fd_, SHUT_RDWR);
+            if (receiver_.joinable()) { receiver_.join(); }
+            ::close(fd_);
+        }
+
+        bool connected() const noexcept         { return connected_.load(); }
+        std::uint64_t lastApplied() const noexcept { return applied_.load(); }
+        const std::string& error() const noexcept { return error_; } // why the link dropped, if not a clean close
+
+        // Runs fn(const std::map<id, HockeyMatch>&) while no records are applied
+        template <typename Fn>
+        void inspect(Fn&& fn) {
+            std::lock_guard lock(mutex_);
+            fn(std::as_const(matches_));
+        }
+
+        // Failover: stops following the primary and returns the replicated matches
+        std::map<std::uint32_t, HockeyMatch> takeOver() {
+            ::shutdown(fd_, SHUT_RDWR);
+            if (receiver_.joinable()) { receiver_.join(); }
+            std::lock_guard lock(mutex_);
+            return std::move(matches_);
+        }
+};
+#endif
+
+// -----------------------------------------------------------------------------
+// ReplicatedEventLog – merges event streams from several scorer devices
+// -----------------------------------------------------------------------------
+// Every device records locally without asking anyone (record()) and ships its
+// DeviceEvents to the others, which merge() them. The merged log is ordered by
+// (hybrid clock, device, counter), so every device that has seen the same set
+// of events builds the same match. Events already seen (same device + counter)
+// are ignored, and when two officials record the same action - same kind, team
+// and card from different devices within dedupe_window_ms - only the first is
+// applied.
+struct DeviceEvent {
+    std::uint64_t hlc;     // hybrid logical clock: wall-clock ms << 16 | logical counter
+    std::uint32_t device;
+    std::uint32_t counter; // per-device sequence; (device, counter) identifies the event
+    MatchAction action;    // clock_ms is always set, by the recording device
+
+    std::uint64_t id() const noexcept { return (std::uint64_t{device} << 32) | counter; }
+
+    friend bool operator<(const DeviceEvent& a, const DeviceEvent& b) noexcept {
+        return std::tie(a.hlc, a.device, a.counter) < std::tie(b.hlc, b.device, b.counter);
+    }
+};
+
+class ReplicatedEventLog {
+    private:
+        std::uint32_t device_;
+        std::uint32_t next_counter_ = 0;
+        std::uint64_t clock_ = 0; // highest hlc issued or seen
+        std::uint32_t dedupe_window_ms_;
+
+        std::vector<DeviceEvent> merged_; // the agreed order
+        std::unordered_set<std::uint64_t> seen_;
+
+        // Materialized state: merged_[0, applied_) has been fed to match_.
+        // trail_[i] says where merged_[i] starts in the match's log and whether
+        // it was applied or dropped as a duplicate, so the match can be rewound
+        // to any point in the merged order.
+        struct Step { std::size_t log_size; bool kept; };
+        HockeyMatch match_;
+        std::size_t applied_ = 0;
+        std::vector<Step> trail_;
+
+        // Last applied observation per (kind, side, card), for duplicate detection
+        struct LastSeen { std::uint64_t hlc = 0; std::uint32_t device = 0; bool valid = false; };
+        std::array<LastSeen, 4 * 3 * 4> last_seen_{};
+
+        std::uint64_t tick() {
+            const auto wall_ms = static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count());
+            clock_ = std::max(clock_ + 1, wall_ms << 16);
+            return clock_;
+        }
+
+        // slotFor() indexes last_seen_ with these bytes, and they may come off the wire
+        static bool valid(const MatchAction& action) noexcept {
+            return action.kind <= ActionKind::NextQuarter && action.side <= Side::Away && action.card <= CardType::Count;
+        }
+
+        static std::size_t slotFor(const MatchAction& action) noexcept {
+            return (static_cast<std::size_t>(action.kind) * 3 + static_cast<std::size_t>(action.side)) * 4
+                 + std::min<std::size_t>(static_cast<std::size_t>(action.card), 3);
+        }
+
+        // Applies merged_[applied_, end) - called after appends at the tail
+        void applyTail() {
+            std::vector<MatchAction> actions;
+            actions.reserve(merged_.size() - applied_);
+            const std::uint64_t window = std::uint64_t{dedupe_window_ms_} << 16;
+            const std::size_t first = applied_;
+            for (; applied_ < merged_.size(); ++applied_) {
+                const DeviceEvent& event = merged_[applied_];
+                LastSeen& last = last_seen_[slotFor(event.action)];
+                const bool duplicate = last.valid && last.device != event.device && event.hlc - last.hlc <= window;
+                trail_.push_back({0, !duplicate});
+                if (duplicate) { continue; } // the same thing seen by a second official
+                last = {event.hlc, event.device, true};
+                actions.push_back(event.action);
+            }
+
+            // Work out where each step's events start: one per applied action,
+            // and a quarter change logs an end plus (before full time) a start
+            std::size_t log_size = match_.events().size();
+            int quarter = match_.quarter();
+            const auto results = match_.applyBatch(actions);
+            std::size_t next = 0;
+            for (std::size_t i = first; i < applied_; ++i) {
+                trail_[i].log_size = log_size;
+                if (!trail_[i].kept || results[next++] != ActionResult::Applied) { continue; }
+                if (merged_[i].action.kind != ActionKind::NextQuarter) {
+                    ++log_size;
+                } else if (quarter < TOTAL_QUARTERS) {
+                    log_size += 2;
+                    ++quarter;
+                } else {
+                    ++log_size;
+                }
+            }
+        }
+
+        // Takes the match back to just before merged_[pos]
+        void rewindTo(std::size_t pos) {
+            match_.rewind(trail_[pos].log_size);
+            trail_.resize(pos);
+            applied_ = pos;
+
+            // Duplicate detection only looks dedupe_window_ms back, so the state
+            // before `pos` can be rebuilt from the steps in that window
+            last_seen_ = {};
+            const std::uint64_t window = std::uint64_t{dedupe_window_ms_} << 16;
+            const std::uint64_t horizon = merged_[pos].hlc > window ? merged_[pos].hlc - window : 0;
+            for (std::size_t i = pos; i-- > 0 && merged_[i].hlc >= horizon;) {
+                LastSeen& last = last_seen_[slotFor(merged_[i].action)];
+                if (trail_[i].kept && !last.valid) {
+                    last = {merged_[i].hlc, merged_[i].device, true};
+                }
+            }
+        }
+
+    public:
+        ReplicatedEventLog(std::uint32_t device, std::string home_name, std::string away_name,
+                           std::uint32_t match_id = 1, std::uint32_t dedupe_window_ms = 3000)
+            :   device_(device),
+                dedupe_window_ms_(dedupe_window_ms),
+                match_(home_name, away_name, match_id) {}
+
+        const HockeyMatch& match() const noexcept { return match_; }
+        std::size_t size() const noexcept         { return merged_.size(); }
+
+        // Follows the merged match. Late events rewind it, so only observers
+        // that follow a rewind (MatchObserver::followsRewind) are accepted.
+        void addObserver(MatchObserver& observer) {
+            if (!observer.followsRewind()) {
+                throw std::invalid_argument("observer cannot follow a match that rewinds");
+            }
+            match_.addObserver(observer);
+        }
+        void removeObserver(MatchObserver& observer) { match_.removeObserver(observer); }
+
+        // Local action: applied at once, returned so it can be shipped to the
+        // other devices. It is stamped with this device's match time unless it
+        // carries one, and every device applies it at that time.
+        DeviceEvent record(MatchAction action) {
+            if (!valid(action)) {
+                throw std::invalid_argument("invalid match action");
+            }
+            if (action.clock_ms == MatchAction::kLiveClock) {
+                action.clock_ms = match_.clockMs();
+            }
+            const DeviceEvent event{tick(), device_, next_counter_++, action};
+            seen_.insert(event.id());
+            merged_.push_back(event); // our clock is ahead of everything we merged, so this is the tail
+            applyTail();
+            return event;
+        }
+
+        // Remote events, in any order and possibly repeated. Events that land
+        // after what we have are applied directly. An event that sorts earlier
+        // rewinds the match to where it belongs and re-applies from there, so
+        // the cost is the number of events after the insertion point.
+        std::size_t merge(std::span<const DeviceEvent> remote) {
+            if (!std::ranges::all_of(remote, [](const DeviceEvent& event) { return valid(event.action); })) {
+                throw std::runtime_error("invalid remote event");
+            }
+            std::vector<DeviceEvent> fresh;
+            fresh.reserve(remote.size());
+            for (const auto& event : remote) {
+                if (seen_.insert(event.id()).second) {
+                    fresh.push_back(event);
+                    clock_ = std::max(clock_, event.hlc);
+                }
+            }
+            if (fresh.empty()) { return 0; }
+            std::sort(fresh.begin(), fresh.end());
+
+            const auto pos = static_cast<std::size_t>(
+                std::lower_bound(merged_.begin(), merged_.end(), fresh.front()) - merged_.begin());
+            const std::size_t old_size = merged_.size();
+            merged_.insert(merged_.end(), fresh.begin(), fresh.end());
+            if (pos < old_size) {
+                std::inplace_merge(merged_.begin() + static_cast<std::ptrdiff_t>(pos),
+                                   merged_.begin() + static_cast<std::ptrdiff_t>(old_size), merged_.end());
+                rewindTo(pos);
+            }
+            applyTail();
+            return fresh.size();
+        }
+
+        // Everything since `after` (exclusive) in merged order - what another device may be missing
+        std::span<const DeviceEvent> eventsAfter(std::size_t after) const {
+            return std::span<const DeviceEvent>(merged_).subspan(std::min(after, merged_.size()));
+        }
+};
+
+// -----------------------------------------------------------------------------
+// SequencedIngest – idempotent, in-order delivery of numbered actions to a match
+// -----------------------------------------------------------------------------
+// Devices number their actions 1, 2, 3, ... per match. Repeats are dropped and
+// actions that arrive early wait in a fixed reorder buffer until the gap before
+// them fills. The watermark (next()) is the lowest number not yet delivered. It
+// moves past a gap when an action arrives kWindow or more beyond it, or when the
+// caller gives up waiting and calls flush(). Everything is fixed size, so ingest
+// itself never allocates.
+class SequencedIngest {
+    public:
+        static constexpr std::uint64_t kWindow = 256;
+
+        enum class Result { Released, Buffered, Duplicate, Late };
+
+    private:
+        using Bits = std::array<std::uint64_t, kWindow / 64>;
+
+        HockeyMatch& match_;
+        std::uint64_t next_ = 1;    // watermark
+        std::uint64_t highest_ = 0; // highest number seen
+
+        std::array<MatchAction, kWindow> slots_{};  // reorder buffer, by seq % kWindow
+        std::array<MatchAction, kWindow> staged_{}; // run being handed to applyBatch
+        Bits pending_{};  // which of [next_, next_ + kWindow) are held
+        Bits released_{}; // which of [next_ - kWindow, next_) were delivered (rather than skipped)
+
+        std::uint64_t duplicates_ = 0;
+        std::uint64_t late_ = 0;
+        std::uint64_t skipped_ = 0;
+
+        static std::size_t slot(std::uint64_t seq) noexcept { return seq % kWindow; }
+        static bool test(const Bits& bits, std::size_t i) noexcept { return (bits[i / 64] >> (i % 64)) & 1; }
+        static void assign(Bits& bits, std::size_t i, bool value) noexcept {
+            const std::uint64_t mask = std::uint64_t{1} << (i % 64);
+            bits[i / 64] = value ? (bits[i / 64] | mask) : (bits[i / 64] & ~mask);
+        }
+
+        // Moves the watermark to `target`, delivering whatever is held below it in order
+        void advanceTo(std::uint64_t target) {
+            std::size_t staged = 0;
+            const std::uint64_t held_end = std::min(target, next_ + kWindow);
+            for (std::uint64_t seq = next_; seq < held_end; ++seq) {
+                const std::size_t i = slot(seq);
+                const bool held = test(pending_, i);
+                if (held) {
+                    staged_[staged++] = slots_[i];
+                    assign(pending_, i, false);
+                } else {
+                    ++skipped_;
+                }
+                assign(released_, i, held);
+            }
+            if (target > held_end) { // jumped further than the buffer reaches: nothing was held there
+                skipped_ += target - held_end;
+                for (std::uint64_t seq = std::max(held_end, target - kWindow); seq < target; ++seq) {
+                    assign(released_, slot(seq), false);
+                }
+            }
+            next_ = target;
+            if (staged == 1) {
+                match_.apply(staged_[0]); // the in-order case: no results vector
+            } else if (staged > 1) {
+                match_.applyBatch(std::span<const MatchAction>(staged_.data(), staged));
+            }
+        }
+
+    public:
+        explicit SequencedIngest(HockeyMatch& match) : match_(match) {}
+
+        std::uint64_t next() const noexcept       { return next_; }
+        std::uint64_t duplicates() const noexcept { return duplicates_; }
+        std::uint64_t late() const noexcept       { return late_; }
+        std::uint64_t skipped() const noexcept    { return skipped_; }
+        std::size_t held() const noexcept {
+            std::size_t count = 0;
+            for (const auto word : pending_) { count += static_cast<std::size_t>(std::popcount(word)); }
+            return count;
+        }
+
+        Result offer(std::uint64_t seq, const MatchAction& action) {
+            if (seq < next_) {
+                if (seq + kWindow >= next_ && test(released_, slot(seq))) {
+                    ++duplicates_;
+                    return Result::Duplicate;
+                }
+                ++late_; // its gap was already given up on
+                return Result::Late;
+            }
+            if (seq >= next_ + kWindow) {
+                advanceTo(seq - kWindow + 1);
+            }
+            const std::size_t i = slot(seq);
+            if (test(pending_, i)) {
+                ++duplicates_;
+                return Result::Duplicate;
+            }
+            slots_[i] = action;
+            assign(pending_, i, true);
+            highest_ = std::max(highest_, seq);
+
+            if (seq != next_) { return Result::Buffered; }
+            std::uint64_t run_end = next_;
+            while (run_end < next_ + kWindow && test(pending_, slot(run_end))) { ++run_end; }
+            advanceTo(run_end);
+            return Result::Released;
+        }
+
+        // For actions entered locally: numbers them after everything seen so far
+        std::uint64_t assign(const MatchAction& action) {
+            const std::uint64_t seq = std::max(next_, highest_ + 1);
+            offer(seq, action);
+            return seq;
+        }
+
+        // Stops waiting for missing numbers and delivers everything held
+        void flush() {
+            if (highest_ >= next_) { advanceTo(highest_ + 1); }
+        }
+};
+
+// -----------------------------------------------------------------------------
+// codec – varints, fixed-width integers and block compression for on-disk data
+// -----------------------------------------------------------------------------
+// Fixed-width integers are little-endian whatever the machine, so files written
+// on one machine can be read on another. compress() is a small LZ77 codec in
+// the LZ4 style. Each sequence is a token (literal length << 4 | match length
+// - 4), the literals, then a 2-byte back offset. A nibble of 15 means more
+// length bytes follow. The last sequence has literals only.
+namespace codec {
+
+inline void putVarint(std::string& out, std::uint64_t value) {
+    while (value >= 0x80) {
+        out.push_back(static_cast<char>((value & 0x7f) | 0x80));
+        value >>= 7;
+    }
+    out.push_back(static_cast<char>(value));
+}
+
+// Consumes a varint from the front of `in`
+inline std::uint64_t getVarint(std::string_view& in) {
+    std::uint64_t value = 0;
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7) {
+        const auto byte = static_cast<unsigned char>(in.front());
+        in.remove_prefix(1);
+        value |= std::uint64_t{byte & 0x7fu} << shift;
+        if ((byte & 0x80) == 0) { return value; }
+    }
+    throw std::runtime_error("truncated varint");
+}
+
+inline void putFixed(std::string& out, std::uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) { out.push_back(static_cast<char>(value >> (8 * i))); }
+}
+
+inline std::uint64_t getFixed(const char* in, int bytes) noexcept {
+    std::uint64_t value = 0;
+    for (int i = 0; i < bytes; ++i) { value |= std::uint64_t{static_cast<unsigned char>(in[i])} << (8 * i); }
+    return value;
+}
+
+inline std::uint32_t fnv1a(std::string_view data) noexcept {
+    std::uint32_t hash = 2166136261u;
+    for (const char c : data) { hash = (hash ^ static_cast<unsigned char>(c)) * 16777619u; }
+    return hash;
+}
+
+inline void putLength(std::string& out, std::size_t extra) {
+    for (; extra >= 255; extra -= 255) { out.push_back(static_cast<char>(255)); }
+    out.push_back(static_cast<char>(extra));
+}
+
+inline void putSequence(std::string& out, std::string_view literals, std::size_t offset, std::size_t match) {
+    const std::size_t match_code = match == 0 ? 0 : match - 4;
+    out.push_back(static_cast<char>((std::min<std::size_t>(literals.size(), 15) << 4)
+                                    | std::min<std::size_t>(match_code, 15)));
+    if (literals.size() >= 15) { putLength(out, literals.size() - 15); }
+    out.append(literals);
+    if (match == 0) { return; }
+    putFixed(out, offset, 2);
+    if (match_code >= 15) { putLength(out, match_code - 15); }
+}
+
+// Appends the compressed form of `in` to `out`
+inline void compress(std::string_view in, std::string& out) {
+    constexpr int kHashBits = 12;
+    std::array<std::uint32_t, 1 << kHashBits> table{};
+    const auto load32 = [&](std::size_t at) {
+        std::uint32_t v;
+        std::memcpy(&v, in.data() + at, sizeof(v));
+        return v;
+    };
+
+    std::size_t anchor = 0, pos = 0;
+    while (pos + 4 <= in.size()) {
+        const std::uint32_t seq = load32(pos);
+        const std::size_t h = (seq * 2654435761u) >> (32 - kHashBits);
+        const std::size_t candidate = table[h];
+        table[h] = static_cast<std::uint32_t>(pos);
+        if (candidate < pos && pos - candidate <= 0xffff && load32(candidate) == seq) {
+            std::size_t match = 4;
+            while (pos + match < in.size() && in[candidate + match] == in[pos + match]) { ++match; }
+            putSequence(out, in.substr(anchor, pos - anchor), pos - candidate, match);
+            pos += match;
+            anchor = pos;
+        } else {
+            ++pos;
+        }
+    }
+    putSequence(out, in.substr(anchor), 0, 0);
+}
+
+// Replaces `out` with the decompressed form of `in`, which must be raw_size bytes
+inline void decompress(std::string_view in, std::size_t raw_size, std::string& out) {
+    out.resize(raw_size);
+    std::size_t at = 0;
+    const auto corrupt = [] { return std::runtime_error("corrupt compressed block"); };
+    const auto readLength = [&](std::size_t length) {
+        if (length < 15) { return length; }
+        for (;;) {
+            if (in.empty()) { throw corrupt(); }
+            const auto byte = static_cast<unsigned char>(in.front());
+            in.remove_prefix(1);
+            length += byte;
+            if (byte != 255) { return length; }
+        }
+    };
+
+    while (!in.empty()) {
+        const auto token = static_cast<unsigned char>(in.front());
+        in.remove_prefix(1);
+        const std::size_t literals = readLength(token >> 4);
+        if (literals > in.size() || literals > raw_size - at) { throw corrupt(); }
+        std::memcpy(out.data() + at, in.data(), literals);
+        in.remove_prefix(literals);
+        at += literals;
+        if (in.empty()) { break; }
+
+        if (in.size() < 2) { throw corrupt(); }
+        const auto offset = static_cast<std::size_t>(getFixed(in.data(), 2));
+        in.remove_prefix(2);
+        const std::size_t match = readLength(token & 0x0f) + 4;
+        if (offset == 0 || offset > at || match > raw_size - at) { throw corrupt(); }
+        for (std::size_t i = 0; i < match; ++i, ++at) { out[at] = out[at - offset]; } // may overlap itself
+    }
+    if (at != raw_size) { throw corrupt(); }
+}
+
+} // namespace codec
+
+// Forces written data to stable storage
+inline void syncFile(int fd) {
+#ifdef _WIN32
+    const int result = ::_commit(fd);
+#else
+    const int result = ::fsync(fd);
+#endif
+    if (result != 0) {
+        throw std::runtime_error("fsync failed");
+    }
+}
+
+
+// -----------------------------------------------------------------------------
+// SeasonStore – log-structured storage for finished matches, season after season
+// -----------------------------------------------------------------------------
+// Writes go to a write-ahead log and an in-memory memtable. The fsync happens
+// after the lock is released and covers every write queued so far (group
+// commit), so readers never wait for the disk. A full memtable is frozen and
+// written by the background thread as an immutable sorted run (run-N.sst).
+// The same thread merges the newest runs once the run before them is no
+// bigger than all of them together, so each record is rewritten O(log n)
+// times. Reads check the memtables, then the runs from newest to oldest. The
+// newest value for a key wins. Hosted matches store themselves from their own
+// threads, so the attached matches are guarded by the same lock.
+//
+// Run file: compressed data blocks, then the block index, then a 24-byte
+// footer (magic, index offset, block count, version). A block holds entries
+// sorted by key: varint key delta, varint value length, value. Each index
+// entry ends with a checksum of the stored block, checked on every load.
+struct SeasonKey {
+    std::uint16_t season = 0;      // year the season starts in
+    std::uint16_t competition = 0;
+    std::uint32_t match_id = 0;
+
+    // Packed so that keys sort by season, then competition, then match
+    std::uint64_t packed() const noexcept {
+        return (std::uint64_t{season} << 48) | (std::uint64_t{competition} << 32) | match_id;
+    }
+
+    static SeasonKey unpack(std::uint64_t key) noexcept {
+        return {static_cast<std::uint16_t>(key >> 48), static_cast<std::uint16_t>(key >> 32),
+                static_cast<std::uint32_t>(key)};
+    }
+};
+
+// Everything the store keeps about a finished match
+struct MatchRecord {
+    SeasonKey key;
+    std::string home_name, away_name;
+    ScoreboardState state;
+    std::vector<MatchEvent> events;
+
+    static MatchRecord from(SeasonKey key, const HockeyMatch& match) {
+        MatchRecord record{key, match.home().name(), match.away().name(), match.state(), {}};
+        record.events.reserve(match.events().size());
+        for (const auto& event : match.events()) { record.events.push_back(event); }
+        return record;
+    }
+
+    void encode(std::string& out) const {
+        const auto putString = [&](std::string_view text) {
+            codec::putVarint(out, text.size());
+            out.append(text);
+        };
+        const auto putCounters = [&](const TeamCounters& c) {
+            for (const int value : {c.goals, c.green, c.yellow, c.red, c.penalty_corners, c.corner_goals}) {
+                codec::putVarint(out, static_cast<std::uint64_t>(value));
+            }
+        };
+        putString(home_name);
+        putString(away_name);
+        putCounters(state.home);
+        putCounters(state.away);
+        codec::putVarint(out, static_cast<std::uint64_t>(state.quarter));
+        codec::putVarint(out, events.size());
+        for (const auto& event : events) {
+            codec::putVarint(out, static_cast<std::uint64_t>(event.quarter()));
+            codec::putVarint(out, event.clockMs());
+            out.push_back(static_cast<char>(event.kind()));
+            out.push_back(static_cast<char>(event.side()));
+            out.push_back(static_cast<char>(event.card()));
+            out.push_back(static_cast<char>(event.player()));
+            putString(event.description());
+        }
+    }
+
+    static MatchRecord decode(SeasonKey key, std::string_view in) {
+        const auto getInt = [&] { return static_cast<int>(codec::getVarint(in)); };
+        const auto getString = [&] {
+            const auto length = codec::getVarint(in);
+            if (length > in.size()) { throw std::runtime_error("truncated match record"); }
+            std::string text(in.substr(0, length));
+            in.remove_prefix(length);
+            return text;
+        };
+        const auto getCounters = [&] {
+            TeamCounters c;
+            for (int* value : {&c.goals, &c.green, &c.yellow, &c.red, &c.penalty_corners, &c.corner_goals}) { *value = getInt(); }
+            return c;
+        };
+        MatchRecord record{key, getString(), getString(), {}, {}};
+        record.state.home = getCounters();
+        record.state.away = getCounters();
+        record.state.quarter = getInt();
+        const auto count = codec::getVarint(in);
+        record.events.reserve(std::min<std::uint64_t>(count, in.size()));
+        for (std::uint64_t i = 0; i < count; ++i) {
+            const int quarter = getInt();
+            const auto clock_ms = static_cast<std::uint32_t>(codec::getVarint(in));
+            if (in.size() < 4) { throw std::runtime_error("truncated match record"); }
+            // Readers index arrays by these, so a flipped bit must not get through
+            const auto kind = static_cast<EventKind>(in[0]);
+            const auto side = static_cast<Side>(in[1]);
+            const auto card = static_cast<CardType>(in[2]);
+            const auto player = static_cast<std::uint8_t>(in[3]);
+            if (kind >= EventKind::Count || side > Side::Away || card > CardType::Count) {
+                throw std::runtime_error("corrupt match record");
+            }
+            in.remove_prefix(4);
+            record.events.emplace_back(quarter, clock_ms, kind, side, card, getString(), player);
+        }
+        return record;
+    }
+};
+
+namespace season {
+
+inline constexpr char kRunMagic[8] = {'H', 'O', 'C', 'K', 'E', 'Y', 'L', 'S'};
+inline constexpr std::uint32_t kRunVersion = 2; // 2 added block checksums
+inline constexpr std::size_t kFooterSize = 24;
+inline constexpr std::size_t kBlockSize = 16 * 1024; // uncompressed bytes per block, roughly
+
+// Source of sorted (key, value) pairs - a memtable or a run
+class Cursor {
+    public:
+        virtual ~Cursor() = default;
+        virtual bool valid() const = 0;
+        virtual std::uint64_t key() const = 0;
+        virtual std::string_view value() const = 0;
+        virtual void next() = 0;
+};
+
+using Entries = std::map<std::uint64_t, std::string>;
+
+class MemCursor : public Cursor {
+    private:
+        Entries::const_iterator it_, end_;
+
+    public:
+        MemCursor(const Entries& entries, std::uint64_t from)
+            : it_(entries.lower_bound(from)), end_(entries.end()) {}
+
+        bool valid() const override              { return it_ != end_; }
+        std::uint64_t key() const override       { return it_->first; }
+        std::string_view value() const override { return it_->second; }
+        void next() override                     { ++it_; }
+};
+
+// Builds a run file block by block; the file only appears under its name once finished
+class RunWriter {
+    private:
+        std::string path_;
+        int fd_;
+        std::string block_, compressed_, index_;
+        std::uint64_t offset_ = 0, block_first_ = 0, last_key_ = 0;
+        std::uint32_t blocks_ = 0;
+
+        void finishBlock() {
+            if (block_.empty()) { return; }
+            compressed_.clear();
+            codec::compress(block_, compressed_);
+            const bool packed = compressed_.size() < block_.size();
+            const std::string_view stored = packed ? std::string_view(compressed_) : std::string_view(block_);
+            writeAll(fd_, stored);
+
+            codec::putVarint(index_, block_first_);
+            codec::putVarint(index_, last_key_);
+            codec::putVarint(index_, offset_);
+            codec::putVarint(index_, stored.size());
+            codec::putVarint(index_, block_.size());
+            index_.push_back(packed ? 1 : 0);
+            codec::putFixed(index_, codec::fnv1a(stored), 4);
+            offset_ += stored.size();
+            ++blocks_;
+            block_.clear();
+        }
+
+    public:
+        explicit RunWriter(std::string path) : path_(std::move(path)), fd_(openForWrite(path_ + ".tmp")) {
+            block_.reserve(kBlockSize + 4096);
+        }
+
+        RunWriter(const RunWriter&) = delete;
+        RunWriter& operator=(const RunWriter&) = delete;
+
+        ~RunWriter() {
+            if (fd_ >= 0) { // abandoned - leave no partial file behind
+                ::close(fd_);
+                std::remove((path_ + ".tmp").c_str());
+            }
+        }
+
+        // Keys must be added in increasing order
+        void add(std::uint64_t key, std::string_view value) {
+            if (block_.empty()) {
+                block_first_ = key;
+                codec::putVarint(block_, key);
+            } else {
+                codec::putVarint(block_, key - last_key_);
+            }
+            codec::putVarint(block_, value.size());
+            block_.append(value);
+            last_key_ = key;
+            if (block_.size() >= kBlockSize) { finishBlock(); }
+        }
+
+        void finish() {
+            finishBlock();
+            std::string tail = std::move(index_);
+            tail.append(kRunMagic, sizeof(kRunMagic));
+            codec::putFixed(tail, offset_, 8);
+            codec::putFixed(tail, blocks_, 4);
+            codec::putFixed(tail, kRunVersion, 4);
+            writeAll(fd_, tail);
+            syncFile(fd_);
+            ::close(fd_);
+            fd_ = -1;
+            if (std::rename((path_ + ".tmp").c_str(), path_.c_str()) != 0) {
+                throw std::runtime_error("cannot rename " + path_);
+            }
+        }
+};
+
+// An immutable sorted run on disk. Once replaced by compaction it is marked
+// obsolete and its file goes away when the last reader lets go of it.
+class Run {
+    private:
+        struct Block {
+            std::uint64_t first, last, offset;
+            std::size_t stored, raw;
+            bool packed;
+            std::optional<std::uint32_t> checksum; // of the stored bytes; version 1 runs have none
+        };
+
+        std::uint64_t number_;
+        std::string path_;
+        MappedFile file_;
+        std::vector<Block> blocks_;
+        mutable std::atomic<bool> obsolete_{false};
+
+    public:
+        Run(std::uint64_t number, std::string path)
+            : number_(number), path_(std::move(path)), file_(path_) {
+            const std::string_view data = file_.view();
+            if (data.size() < kFooterSize
+                || std::memcmp(data.data() + data.size() - kFooterSize, kRunMagic, sizeof(kRunMagic)) != 0) {
+                throw std::runtime_error(path_ + " is not a season run");
+            }
+            const char* footer = data.data() + data.size() - kFooterSize;
+            const auto index_offset = codec::getFixed(footer + 8, 8);
+            const auto count = codec::getFixed(footer + 16, 4);
+            const auto version = codec::getFixed(footer + 20, 4);
+            if (version < 1 || version > kRunVersion || index_offset > data.size() - kFooterSize) {
+                throw std::runtime_error(path_ + " has an unsupported layout");
+            }
+            std::string_view index = data.substr(index_offset, data.size() - kFooterSize - index_offset);
+            blocks_.reserve(count);
+            for (std::uint64_t i = 0; i < count; ++i) {
+                Block block{};
+                block.first = codec::getVarint(index);
+                block.last = codec::getVarint(index);
+                block.offset = codec::getVarint(index);
+                block.stored = codec::getVarint(index);
+                block.raw = codec::getVarint(index);
+                if (index.empty() || block.offset + block.stored > index_offset) {
+                    throw std::runtime_error(path_ + " has a corrupt index");
+                }
+                block.packed = index.front() != 0;
+                index.remove_prefix(1);
+                if (version >= 2) {
+                    if (index.size() < 4) { throw std::runtime_error(path_ + " has a corrupt index"); }
+                    block.checksum = static_cast<std::uint32_t>(codec::getFixed(index.data(), 4));
+                    index.remove_prefix(4);
+                }
+                blocks_.push_back(block);
+            }
+        }
+
+        ~Run() {
+            if (obsolete_) { std::remove(path_.c_str()); }
+        }
+
+        std::uint64_t number() const noexcept { return number_; }
+        std::size_t bytes() const noexcept    { return file_.view().size(); }
+        void retire() const noexcept          { obsolete_ = true; }
+
+        std::size_t blockCount() const noexcept { return blocks_.size(); }
+
+        // First block that may hold keys >= key
+        std::size_t findBlock(std::uint64_t key) const noexcept {
+            return static_cast<std::size_t>(std::partition_point(blocks_.begin(), blocks_.end(),
+                [&](const Block& b) { return b.last < key; }) - blocks_.begin());
+        }
+
+        std::uint64_t blockFirst(std::size_t i) const noexcept { return blocks_[i].first; }
+
+        // Uncompressed block contents; `scratch` backs the view when the block is compressed
+        std::string_view loadBlock(std::size_t i, std::string& scratch) const {
+            const Block& block = blocks_[i];
+            const std::string_view stored = file_.view().substr(block.offset, block.stored);
+            if (block.checksum && codec::fnv1a(stored) != *block.checksum) {
+                throw std::runtime_error(path_ + " has a corrupt block");
+            }
+            if (!block.packed) { return stored; }
+            codec::decompress(stored, block.raw, scratch);
+            return scratch;
+        }
+};
+
+class RunCursor : public Cursor {
+    private:
+        std::shared_ptr<const Run> run_;
+        std::size_t block_;
+        std::string scratch_;
+        std::string_view rest_, value_;
+        std::uint64_t key_ = 0;
+        bool valid_ = false;
+
+        bool loadNext() {
+            while (rest_.empty()) {
+                if (block_ >= run_->blockCount()) { return false; }
+                rest_ = run_->loadBlock(block_, scratch_);
+                key_ = run_->blockFirst(block_++);
+                codec::getVarint(rest_); // the first key is absolute; it is also in the index
+                readValue();
+                return true;
+            }
+            key_ += codec::getVarint(rest_);
+            readValue();
+            return true;
+        }
+
+        void readValue() {
+            const auto length = codec::getVarint(rest_);
+            if (length > rest_.size()) { throw std::runtime_error("corrupt season run block"); }
+            value_ = rest_.substr(0, length);
+            rest_.remove_prefix(length);
+        }
+
+    public:
+        RunCursor(std::shared_ptr<const Run> run, std::uint64_t from)
+            : run_(std::move(run)), block_(run_->findBlock(from)) {
+            valid_ = loadNext();
+            while (valid_ && key_ < from) { valid_ = loadNext(); }
+        }
+
+        bool valid() const override              { return valid_; }
+        std::uint64_t key() const override       { return key_; }
+        std::string_view value() const override { return value_; }
+        void next() override                     { valid_ = loadNext(); }
+};
+
+// Visits the union of `sources` (newest first) in key order up to `last`;
+// where several hold a key, the newest one's value is used
+template <typename Fn>
+void mergeCursors(std::vector<std::unique_ptr<Cursor>>& sources, std::uint64_t last, Fn&& fn) {
+    for (;;) {
+        Cursor* best = nullptr;
+        for (auto& source : sources) {
+            if (source->valid() && source->key() <= last && (best == nullptr || source->key() < best->key())) {
+                best = source.get();
+            }
+        }
+        if (best == nullptr) { return; }
+        const std::uint64_t key = best->key();
+        fn(key, best->value());
+        for (auto& source : sources) {
+            if (source->valid() && source->key() == key) { source->next(); }
+        }
+    }
+}
+
+} // namespace season
+
+class SeasonStore : public MatchObserver {
+    private:
+        struct Memtable {
+            season::Entries entries;
+            std::size_t bytes = 0;
+            std::vector<std::string> wal_paths; // deleted once the memtable is in a run
+        };
+
+        std::string dir_;
+        std::size_t memtable_limit_;
+
+        mutable std::shared_mutex mutex_; // guards everything down to compactor_
+        std::shared_ptr<Memtable> active_;
+        std::vector<std::shared_ptr<const Memtable>> frozen_;   // oldest first, waiting for the background thread
+        std::vector<std::shared_ptr<const season::Run>> runs_;  // oldest first
+        std::uint64_t next_file_ = 1;
+        int wal_fd_ = -1;
+        std::vector<int> retired_wal_fds_; // rotated logs, closed once fsynced
+        std::uint64_t appended_ = 0;       // log records written
+        std::string error_;
+        std::unordered_map<std::uint32_t, SeasonKey> attached_; // match id -> where it is stored
+        bool stopping_ = false;
+        std::condition_variable_any work_;
+        std::thread compactor_;
+
+        std::mutex sync_mutex_;      // held by the one thread running a group fsync
+        std::uint64_t synced_ = 0;   // log records known to be on disk; guarded by sync_mutex_
+
+
+        std::string filePath(const char* prefix, std::uint64_t number, const char* suffix) const {
+            return std::format("{}/{}-{:08}{}", dir_, prefix, number, suffix);
+        }
+
+        // With the lock held: starts a new memtable and write-ahead log
+        void rotate() {
+            if (wal_fd_ >= 0) { retired_wal_fds_.push_back(wal_fd_); }
+            if (active_ && !active_->entries.empty()) {
+                frozen_.push_back(std::move(active_));
+                work_.notify_one();
+            } else if (active_) {
+                for (const auto& path : active_->wal_paths) { std::remove(path.c_str()); }
+            }
+            active_ = std::make_shared<Memtable>();
+            active_->wal_paths.push_back(filePath("wal", next_file_++, ".log"));
+            wal_fd_ = openForWrite(active_->wal_paths.back());
+        }
+
+        // Makes log records up to `sequence` durable. Whoever gets here first
+        // fsyncs for everyone behind it; they then find their records covered.
+        void syncThrough(std::uint64_t sequence) {
+            std::lock_guard sync(sync_mutex_);
+            if (synced_ >= sequence) { return; }
+            std::vector<int> retired;
+            int fd = -1;
+            std::uint64_t target = 0;
+            {
+                std::unique_lock lock(mutex_);
+                retired.swap(retired_wal_fds_);
+                fd = wal_fd_; // only closed by a later syncThrough() or the destructor
+                target = appended_;
+            }
+            try {
+                for (const int old : retired) { syncFile(old); }
+                syncFile(fd);
+            } catch (...) {
+                std::unique_lock lock(mutex_);
+                retired_wal_fds_.insert(retired_wal_fds_.begin(), retired.begin(), retired.end());
+                throw;
+            }
+            for (const int old : retired) { ::close(old); }
+            synced_ = target;
+        }
+
+        // Write-ahead log record: length, checksum, key, value. A torn tail is ignored on replay.
+        static void replayLog(const std::string& path, Memtable& into) {
+            const MappedFile file(path);
+            std::string_view data = file.view();
+            while (data.size() >= 16) {
+                const auto length = codec::getFixed(data.data(), 4);
+                const auto checksum = static_cast<std::uint32_t>(codec::getFixed(data.data() + 4, 4));
+                if (length < 8 || length > data.size() - 8 || codec::fnv1a(data.substr(8, length)) != checksum) {
+                    break;
+                }
+                const auto key = codec::getFixed(data.data() + 8, 8);
+                std::string& slot = into.entries[key];
+                slot.assign(data.substr(16, length - 8));
+                into.bytes += slot.size();
+                data.remove_prefix(8 + length);
+            }
+        }
+
+        std::vector<std::unique_ptr<season::Cursor>> runCursors(
+                std::span<const std::shared_ptr<const season::Run>> runs, std::uint64_t from) const {
+            std::vector<std::unique_ptr<season::Cursor>> cursors;
+            for (auto it = runs.rbegin(); it != runs.rend(); ++it) {
+                cursors.push_back(std::make_unique<season::RunCursor>(*it, from));
+            }
+            return cursors;
+        }
+
+        std::shared_ptr<const season::Run> writeRun(std::vector<std::unique_ptr<season::Cursor>>& sources) {
+            std::uint64_t number = 0;
+            {
+                std::unique_lock lock(mutex_);
+                number = next_file_++;
+            }
+            const std::string path = filePath("run", number, ".sst");
+            season::RunWriter writer(path);
+            season::mergeCursors(sources, std::numeric_limits<std::uint64_t>::max(),
+                                 [&](std::uint64_t key, std::string_view value) { writer.add(key, value); });
+            writer.finish();
+            return std::make_shared<const season::Run>(number, path);
+        }
+
+        // Merge the newest runs while the run before them is no bigger than all of them together
+        void compact() {
+            std::vector<std::shared_ptr<const season::Run>> runs;
+            {
+                std::shared_lock lock(mutex_);
+                runs = runs_;
+            }
+            std::size_t first = runs.size();
+            std::size_t newer = 0;
+            while (first > 0 && (first == runs.size() || runs[first - 1]->bytes() <= newer)) {
+                newer += runs[--first]->bytes();
+            }
+            if (runs.size() - first < 4) { return; }
+
+            const auto inputs = std::span(runs).subspan(first);
+            auto sources = runCursors(inputs, 0);
+            auto merged = writeRun(sources);
+            std::unique_lock lock(mutex_);
+            // Only this thread changes runs_, so the inputs are still its tail
+            runs_.erase(runs_.begin() + static_cast<std::ptrdiff_t>(first), runs_.end());
+            runs_.push_back(std::move(merged));
+            for (const auto& run : inputs) { run->retire(); }
+        }
+
+        void backgroundLoop() {
+            std::unique_lock lock(mutex_);
+            for (;;) {
+                work_.wait(lock, [&] { return stopping_ || !frozen_.empty(); });
+                if (frozen_.empty()) { return; } // stopping, nothing left to write
+                const auto memtable = frozen_.front();
+                lock.unlock();
+                try {
+                    std::vector<std::unique_ptr<season::Cursor>> sources;
+                    sources.push_back(std::make_unique<season::MemCursor>(memtable->entries, 0));
+                    auto run = writeRun(sources);
+                    lock.lock();
+                    runs_.push_back(std::move(run));
+                    frozen_.erase(frozen_.begin());
+                    lock.unlock();
+                    for (const auto& path : memtable->wal_paths) { std::remove(path.c_str()); }
+                    compact();
+                    lock.lock();
+                } catch (const std::exception& e) {
+                    lock.lock();
+                    error_ = e.what();
+                    if (stopping_) { return; } // the write-ahead logs are still there for next time
+                    work_.wait_for(lock, std::chrono::seconds(1));
+                }
+                work_.notify_all(); // flush() waits for frozen_ to empty
+            }
+        }
+
+    public:
+        explicit SeasonStore(std::string dir, std::size_t memtable_limit = 4 << 20)
+            : dir_(std::move(dir)), memtable_limit_(memtable_limit) {
+            std::filesystem::create_directories(dir_);
+            std::vector<std::pair<std::uint64_t, std::string>> runs, logs;
+            for (const auto& entry : std::filesystem::directory_iterator(dir_)) {
+                const std::string name = entry.path().filename().string();
+                const std::string path = entry.path().string();
+                std::uint64_t number = 0;
+                const auto parsed = std::from_chars(name.data() + std::min<std::size_t>(4, name.size()),
+                                                    name.data() + name.size(), number);
+                if (name.ends_with(".tmp")) {
+                    std::remove(path.c_str()); // left by a crash during a write
+                } else if (name.starts_with("run-") && name.ends_with(".sst") && parsed.ec == std::errc{}) {
+                    runs.emplace_back(number, path);
+                } else if (name.starts_with("wal-") && name.ends_with(".log") && parsed.ec == std::errc{}) {
+                    logs.emplace_back(number, path);
+                }
+                next_file_ = std::max(next_file_, number + 1);
+            }
+            std::sort(runs.begin(), runs.end());
+            std::sort(logs.begin(), logs.end());
+            for (auto& [number, path] : runs) {
+                runs_.push_back(std::make_shared<const season::Run>(number, std::move(path)));
+            }
+            // Logs left over from the last session hold writes that never reached a run
+            active_ = std::make_shared<Memtable>();
+            for (auto& [number, path] : logs) {
+                replayLog(path, *active_);
+                active_->wal_paths.push_back(std::move(path));
+            }
+            if (active_->entries.empty()) {
+                for (const auto& path : active_->wal_paths) { std::remove(path.c_str()); }
+                active_.reset();
+            }
+            rotate();
+            compactor_ = std::thread([this] { backgroundLoop(); });
+        }
+
+        SeasonStore(const SeasonStore&) = delete;
+        SeasonStore& operator=(const SeasonStore&) = delete;
+
+        ~SeasonStore() override {
+            {
+                std::unique_lock lock(mutex_);
+                for (const int fd : retired_wal_fds_) { ::close(fd); }
+                ::close(wal_fd_);
+                if (!active_->entries.empty()) {
+                    frozen_.push_back(std::move(active_));
+                } else {
+                    for (const auto& path : active_->wal_paths) { std::remove(path.c_str()); }
+                }
+                stopping_ = true;
+            }
+            work_.notify_all();
+            compactor_.join();
+        }
+
+        // Last background write failure, if any; the data is still in the write-ahead log
+        std::string error() const {
+            std::shared_lock lock(mutex_);
+            return error_;
+        }
+
+        std::size_t runCount() const {
+            std::shared_lock lock(mutex_);
+            return runs_.size();
+        }
+
+        void put(const MatchRecord& record) {
+            std::string value;
+            record.encode(value);
+            const std::uint64_t key = record.key.packed();
+
+            std::string log_record;
+            log_record.reserve(16 + value.size());
+            codec::putFixed(log_record, 8 + value.size(), 4);
+            codec::putFixed(log_record, 0, 4); // checksum, filled in below
+            codec::putFixed(log_record, key, 8);
+            log_record += value;
+            const auto checksum = codec::fnv1a(std::string_view(log_record).substr(8));
+            for (int i = 0; i < 4; ++i) { log_record[4 + static_cast<std::size_t>(i)] = static_cast<char>(checksum >> (8 * i)); }
+
+            std::unique_lock lock(mutex_);
+            writeAll(wal_fd_, log_record);
+            const std::uint64_t sequence = ++appended_;
+            std::string& slot = active_->entries[key];
+            active_->bytes += value.size() - std::min(value.size(), slot.size());
+            slot = std::move(value);
+            if (active_->bytes >= memtable_limit_) { rotate(); }
+            lock.unlock();
+            syncThrough(sequence);
+        }
+
+        std::optional<MatchRecord> get(SeasonKey key) const {
+            const std::uint64_t packed = key.packed();
+            std::vector<std::shared_ptr<const season::Run>> runs;
+            {
+                std::shared_lock lock(mutex_);
+                if (const auto it = active_->entries.find(packed); it != active_->entries.end()) {
+                    return MatchRecord::decode(key, it->second);
+                }
+                for (auto memtable = frozen_.rbegin(); memtable != frozen_.rend(); ++memtable) {
+                    if (const auto it = (*memtable)->entries.find(packed); it != (*memtable)->entries.end()) {
+                        return MatchRecord::decode(key, it->second);
+                    }
+                }
+                runs = runs_;
+            }
+            for (auto run = runs.rbegin(); run != runs.rend(); ++run) {
+                const season::RunCursor cursor(*run, packed);
+                if (cursor.valid() && cursor.key() == packed) { return MatchRecord::decode(key, cursor.value()); }
+            }
+            return std::nullopt;
+        }
+
+        // Every stored match with first <= key <= last, in key order
+        std::vector<MatchRecord> range(SeasonKey first, SeasonKey last) const {
+            season::Entries active; // copied: the writer keeps changing it
+            std::vector<std::shared_ptr<const Memtable>> frozen;
+            std::vector<std::shared_ptr<const season::Run>> runs;
+            {
+                std::shared_lock lock(mutex_);
+                active.insert(active_->entries.lower_bound(first.packed()),
+                              active_->entries.upper_bound(last.packed()));
+                frozen = frozen_;
+                runs = runs_;
+            }
+            std::vector<std::unique_ptr<season::Cursor>> sources;
+            sources.push_back(std::make_unique<season::MemCursor>(active, first.packed()));
+            for (auto memtable = frozen.rbegin(); memtable != frozen.rend(); ++memtable) {
+                sources.push_back(std::make_unique<season::MemCursor>((*memtable)->entries, first.packed()));
+            }
+            for (auto& cursor : runCursors(runs, first.packed())) { sources.push_back(std::move(cursor)); }
+
+            std::vector<MatchRecord> records;
+            season::mergeCursors(sources, last.packed(), [&](std::uint64_t key, std::string_view value) {
+                records.push_back(MatchRecord::decode(SeasonKey::unpack(key), value));
+            });
+            return records;
+        }
+
+        // Writes the current memtable out as a run and waits until the background thread is idle
+        void flush() {
+            std::unique_lock lock(mutex_);
+            rotate();
+            work_.wait(lock, [&] { return frozen_.empty() || !error_.empty(); });
+        }
+
+        // Stores the match under `key` when its final whistle goes
+        void attach(HockeyMatch& match, std::uint16_t season, std::uint16_t competition) {
+            {
+                std::unique_lock lock(mutex_);
+                attached_[match.id()] = {season, competition, match.id()};
+            }
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) {
+            match.removeObserver(*this);
+            std::unique_lock lock(mutex_);
+            attached_.erase(match.id());
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            if (event.kind() != EventKind::QuarterEnd || !match.finished()) { return; }
+            SeasonKey key;
+            {
+                std::shared_lock lock(mutex_);
+                const auto it = attached_.find(match.id());
+                if (it == attached_.end()) { return; }
+                key = it->second;
+            }
+            try {
+                put(MatchRecord::from(key, match));
+            } catch (const std::exception& e) {
+                std::unique_lock lock(mutex_);
+                error_ = std::string("cannot store match: ") + e.what();
+            }
+        }
+};
+
+// -----------------------------------------------------------------------------
+// MatchArchive – finished matches kept in memory as compressed blocks
+// -----------------------------------------------------------------------------
+// Live matches stay HockeyMatch objects. Once a match is over, retire() packs
+// it into one block. Each distinct description is stored once, in a dictionary.
+// Per event the block stores a packed byte for kind, side and card, the quarter
+// and clock as varint deltas, the player (cards only) and a dictionary index.
+// The block is then LZ-compressed. get() unpacks a block into a MatchRecord.
+// The most recently used records stay in a bounded LRU cache, so repeat
+// lookups of popular matches skip decompression.
+class MatchArchive {
+    private:
+        struct Block {
+            std::string bytes;
+            std::size_t raw_size;
+        };
+
+        using Entry = std::pair<std::uint64_t, std::shared_ptr<const MatchRecord>>;
+
+        std::size_t cache_capacity_;
+        mutable std::mutex mutex_; // guards everything below
+        std::unordered_map<std::uint64_t, Block> blocks_;
+        std::size_t stored_bytes_ = 0;
+        mutable std::list<Entry> lru_; // most recent first
+        mutable std::unordered_map<std::uint64_t, std::list<Entry>::iterator> cached_;
+
+        static std::uint64_t zigzag(std::int64_t value) noexcept {
+            return (static_cast<std::uint64_t>(value) << 1) ^ static_cast<std::uint64_t>(value >> 63);
+        }
+        static std::int64_t unzigzag(std::uint64_t value) noexcept {
+            return static_cast<std::int64_t>(value >> 1) ^ -static_cast<std::int64_t>(value & 1);
+        }
+
+        // Events: HockeyMatch's EventLog or a MatchRecord's events
+        template <typename Events>
+        static std::string pack(std::string_view home, std::string_view away, const ScoreboardState& state,
+                                const Events& match_events) {
+            std::string out;
+            const auto putString = [&](std::string_view text) {
+                codec::putVarint(out, text.size());
+                out.append(text);
+            };
+            putString(home);
+            putString(away);
+            for (const TeamCounters& c : {state.home, state.away}) {
+                for (const int value : {c.goals, c.green, c.yellow, c.red, c.penalty_corners, c.corner_goals}) {
+                    codec::putVarint(out, static_cast<std::uint64_t>(value));
+                }
+            }
+            codec::putVarint(out, static_cast<std::uint64_t>(state.quarter));
+
+            std::unordered_map<std::string_view, std::uint32_t> dictionary;
+            std::vector<std::string_view> words;
+            std::string events;
+            int quarter = 0;
+            std::uint32_t clock = 0;
+            for (const auto& event : match_events) {
+                const auto [it, added] = dictionary.try_emplace(event.description(), static_cast<std::uint32_t>(words.size()));
+                if (added) { words.push_back(event.description()); }
+                events.push_back(static_cast<char>(static_cast<unsigned>(event.kind())
+                                                   | (static_cast<unsigned>(event.side()) << 3)
+                                                   | (static_cast<unsigned>(event.card()) << 5)));
+                codec::putVarint(events, zigzag(event.quarter() - quarter));
+                codec::putVarint(events, zigzag(static_cast<std::int64_t>(event.clockMs()) - clock));
+                if (event.kind() == EventKind::Card) { events.push_back(static_cast<char>(event.player())); }
+                codec::putVarint(events, it->second);
+                quarter = event.quarter();
+                clock = event.clockMs();
+            }
+            codec::putVarint(out, words.size());
+            for (const auto word : words) { putString(word); }
+            codec::putVarint(out, match_events.size());
+            out += events;
+            return out;
+        }
+
+        static MatchRecord unpack(SeasonKey key, std::string_view in) {
+            const auto getString = [&] {
+                const auto length = codec::getVarint(in);
+                if (length > in.size()) { throw std::runtime_error("corrupt archived match"); }
+                std::string text(in.substr(0, length));
+                in.remove_prefix(length);
+                return text;
+            };
+            MatchRecord record{key, getString(), getString(), {}, {}};
+            for (TeamCounters* c : {&record.state.home, &record.state.away}) {
+                for (int* value : {&c->goals, &c->green, &c->yellow, &c->red, &c->penalty_corners, &c->corner_goals}) {
+                    *value = static_cast<int>(codec::getVarint(in));
+                }
+            }
+            record.state.quarter = static_cast<int>(codec::getVarint(in));
+
+            // Every word takes at least its length byte, so a larger count is corrupt
+            const auto word_count = codec::getVarint(in);
+            if (word_count > in.size()) { throw std::runtime_error("corrupt archived match"); }
+            std::vector<std::string> words(word_count);
+            for (auto& word : words) { word = getString(); }
+            const auto count = codec::getVarint(in);
+            record.events.reserve(std::min<std::uint64_t>(count, in.size()));
+            int quarter = 0;
+            std::int64_t clock = 0;
+            for (std::uint64_t i = 0; i < count; ++i) {
+                if (in.empty()) { throw std::runtime_error("corrupt archived match"); }
+                const auto packed = static_cast<unsigned char>(in.front());
+                in.remove_prefix(1);
+                const auto kind = static_cast<EventKind>(packed & 0x7);
+                const auto side = static_cast<Side>((packed >> 3) & 0x3);
+                if (kind >= EventKind::Count || side > Side::Away) { throw std::runtime_error("corrupt archived match"); }
+                quarter += static_cast<int>(unzigzag(codec::getVarint(in)));
+                clock += unzigzag(codec::getVarint(in));
+                std::uint8_t player = 0;
+                if (kind == EventKind::Card) {
+                    if (in.empty()) { throw std::runtime_error("corrupt archived match"); }
+                    player = static_cast<std::uint8_t>(in.front());
+                    in.remove_prefix(1);
+                }
+                const auto word = codec::getVarint(in);
+                if (word >= words.size()) { throw std::runtime_error("corrupt archived match"); }
+                record.events.emplace_back(quarter, static_cast<std::uint32_t>(clock), kind,
+                                           side, static_cast<CardType>((packed >> 5) & 0x3), words[word], player);
+            }
+            return record;
+        }
+
+        void store(SeasonKey key, const std::string& raw) {
+            HOCKEY_TRACE("archive.retire");
+            Block block{{}, raw.size()};
+            codec::compress(raw, block.bytes);
+            block.bytes.shrink_to_fit();
+
+            std::lock_guard lock(mutex_);
+            const std::uint64_t packed_key = key.packed();
+            if (const auto it = cached_.find(packed_key); it != cached_.end()) {
+                lru_.erase(it->second);
+                cached_.erase(it);
+            }
+            auto& slot = blocks_[packed_key];
+            stored_bytes_ += block.bytes.size();
+            stored_bytes_ -= slot.bytes.size();
+            slot = std::move(block);
+        }
+
+    public:
+        explicit MatchArchive(std::size_t cache_capacity = 64) : cache_capacity_(std::max<std::size_t>(cache_capacity, 1)) {}
+
+        // Packs the match; a match already archived under the key is replaced
+        void retire(SeasonKey key, const HockeyMatch& match) {
+            store(key, pack(match.home().name(), match.away().name(), match.state(), match.events()));
+        }
+
+        // Same for a match loaded from the season database
+        void retire(const MatchRecord& record) {
+            store(record.key, pack(record.home_name, record.away_name, record.state, record.events));
+        }
+
+        // The archived match, or nullptr if there is none
+        std::shared_ptr<const MatchRecord> get(SeasonKey key) const {
+            HOCKEY_TRACE("archive.get");
+            const std::uint64_t packed_key = key.packed();
+            std::string raw;
+            {
+                std::lock_guard lock(mutex_);
+                if (const auto it = cached_.find(packed_key); it != cached_.end()) {
+                    lru_.splice(lru_.begin(), lru_, it->second);
+                    return it->second->second;
+                }
+                const auto block = blocks_.find(packed_key);
+                if (block == blocks_.end()) { return nullptr; }
+                codec::decompress(block->second.bytes, block->second.raw_size, raw);
+            }
+            auto record = std::make_shared<const MatchRecord>(unpack(key, raw));
+
+            std::lock_guard lock(mutex_);
+            if (const auto it = cached_.find(packed_key); it != cached_.end()) { // another thread got there first
+                return it->second->second;
+            }
+            lru_.emplace_front(packed_key, record);
+            cached_[packed_key] = lru_.begin();
+            if (lru_.size() > cache_capacity_) {
+                cached_.erase(lru_.back().first);
+                lru_.pop_back();
+            }
+            return record;
+        }
+
+        std::size_t size() const {
+            std::lock_guard lock(mutex_);
+            return blocks_.size();
+        }
+
+        // Compressed bytes held, not counting the cache
+        std::size_t storedBytes() const {
+            std::lock_guard lock(mutex_);
+            return stored_bytes_;
+        }
+};
+
+// -----------------------------------------------------------------------------
+// EventIndex – secondary indexes over events from live and archived matches
+// -----------------------------------------------------------------------------
+// Every indexed event gets a number, in the order it was indexed. For each
+// team, kind, card, quarter and season there is a posting list: the sorted
+// numbers of the events that match. Adding an event only appends, so lists
+// stay sorted for free. A query intersects the lists of its predicates,
+// starting from the shortest and galloping through the others. Its cost
+// follows the shortest list, not the number of events. Hosted matches index
+// from their worker threads, so queries share a lock with them.
+struct EventQuery {
+    std::optional<std::string> team;
+    std::optional<EventKind> kind;
+    std::optional<CardType> card;
+    std::optional<int> quarter;
+    std::optional<std::uint16_t> season;
+};
+
+struct EventHit {
+    SeasonKey match;
+    std::uint32_t position; // index into the match's event log
+};
+
+class EventIndex : public MatchObserver {
+    private:
+        using Postings = std::vector<std::uint32_t>;
+
+        mutable std::shared_mutex mutex_;        // guards everything below
+        std::vector<SeasonKey> matches_;         // by match ordinal
+        std::vector<std::uint32_t> match_of_;    // by event number
+        std::vector<std::uint32_t> position_of_; // by event number
+
+        std::unordered_map<std::string, std::uint32_t> team_ids_;
+        std::vector<Postings> by_team_;
+        std::array<Postings, static_cast<std::size_t>(EventKind::Count)> by_kind_;
+        std::array<Postings, static_cast<std::size_t>(CardType::Count)> by_card_;
+        std::array<Postings, TOTAL_QUARTERS + 1> by_quarter_;
+        std::unordered_map<std::uint16_t, Postings> by_season_;
+
+        // Live matches: match id -> (ordinal, home team id, away team id)
+        struct Live { std::uint32_t ordinal, home, away; };
+        std::unordered_map<std::uint32_t, Live> live_;
+
+        static const Postings& none() {
+            static const Postings empty;
+            return empty;
+        }
+
+        std::uint32_t teamId(const std::string& name) {
+            const auto [it, added] = team_ids_.try_emplace(name, static_cast<std::uint32_t>(by_team_.size()));
+            if (added) { by_team_.emplace_back(); }
+            return it->second;
+        }
+
+        std::uint32_t addMatch(SeasonKey key) {
+            matches_.push_back(key);
+            return static_cast<std::uint32_t>(matches_.size() - 1);
+        }
+
+        void addEvent(std::uint32_t ordinal, std::uint32_t home, std::uint32_t away, std::uint32_t position,
+                      const MatchEvent& event) {
+            const auto number = static_cast<std::uint32_t>(match_of_.size());
+            match_of_.push_back(ordinal);
+            position_of_.push_back(position);
+            if (event.side() != Side::None) {
+                by_team_[event.side() == Side::Home ? home : away].push_back(number);
+            }
+            by_kind_[static_cast<std::size_t>(event.kind())].push_back(number);
+            if (event.kind() == EventKind::Card && event.card() != CardType::Count) {
+                by_card_[static_cast<std::size_t>(event.card())].push_back(number);
+            }
+            if (event.quarter() >= 0 && event.quarter() <= TOTAL_QUARTERS) {
+                by_quarter_[static_cast<std::size_t>(event.quarter())].push_back(number);
+            }
+            by_season_[matches_[ordinal].season].push_back(number);
+        }
+
+        // The posting lists a query needs; empty when it has no predicates
+        std::vector<const Postings*> listsFor(const EventQuery& query) const {
+            std::vector<const Postings*> lists;
+            if (query.team) {
+                const auto it = team_ids_.find(*query.team);
+                lists.push_back(it == team_ids_.end() ? &none() : &by_team_[it->second]);
+            }
+            if (query.kind)    { lists.push_back(&by_kind_[static_cast<std::size_t>(*query.kind)]); }
+            if (query.card)    { lists.push_back(*query.card == CardType::Count ? &none() : &by_card_[static_cast<std::size_t>(*query.card)]); }
+            if (query.quarter) {
+                lists.push_back(*query.quarter < 0 || *query.quarter > TOTAL_QUARTERS
+                                ? &none() : &by_quarter_[static_cast<std::size_t>(*query.quarter)]);
+            }
+            if (query.season) {
+                const auto it = by_season_.find(*query.season);
+                lists.push_back(it == by_season_.end() ? &none() : &it->second);
+            }
+            return lists;
+        }
+
+        // Event numbers matching every predicate of the query, ascending
+        std::vector<std::uint32_t> matchingLocked(const EventQuery& query) const {
+            auto lists = listsFor(query);
+            std::vector<std::uint32_t> result;
+            if (lists.empty()) { // no predicates: everything
+                result.resize(match_of_.size());
+                for (std::uint32_t i = 0; i < result.size(); ++i) { result[i] = i; }
+                return result;
+            }
+            std::sort(lists.begin(), lists.end(), [](const Postings* a, const Postings* b) { return a->size() < b->size(); });
+            if (lists.front()->empty()) { return result; }
+
+            std::vector<Postings::const_iterator> cursors;
+            for (const auto* list : lists) { cursors.push_back(list->begin()); }
+            for (const std::uint32_t candidate : *lists.front()) {
+                bool in_all = true;
+                for (std::size_t l = 1; l < lists.size() && in_all; ++l) {
+                    // Gallop: double the step until past the candidate, then binary search
+                    auto& cursor = cursors[l];
+                    const auto end = lists[l]->end();
+                    std::size_t step = 1;
+                    auto low = cursor;
+                    while (end - low > static_cast<std::ptrdiff_t>(step) && *(low + static_cast<std::ptrdiff_t>(step)) < candidate) {
+                        low += static_cast<std::ptrdiff_t>(step);
+                        step *= 2;
+                    }
+                    const auto high = end - low > static_cast<std::ptrdiff_t>(step) ? low + static_cast<std::ptrdiff_t>(step) + 1 : end;
+                    cursor = std::lower_bound(low, high, candidate);
+                    if (cursor == end) { return result; } // nothing further can match
+                    in_all = *cursor == candidate;
+                }
+                if (in_all) { result.push_back(candidate); }
+            }
+            return result;
+        }
+
+    public:
+        std::size_t size() const {
+            std::shared_lock lock(mutex_);
+            return match_of_.size();
+        }
+
+        void add(const MatchRecord& record) {
+            std::unique_lock lock(mutex_);
+            const std::uint32_t ordinal = addMatch(record.key);
+            const std::uint32_t home = teamId(record.home_name);
+            const std::uint32_t away = teamId(record.away_name);
+            for (std::uint32_t i = 0; i < record.events.size(); ++i) {
+                addEvent(ordinal, home, away, i, record.events[i]);
+            }
+        }
+
+        // Indexes what the match has so far and every event it adds from now on
+        void attach(HockeyMatch& match, SeasonKey key) {
+            key.match_id = match.id();
+            std::unique_lock lock(mutex_);
+            const Live live{addMatch(key), teamId(match.home().name()), teamId(match.away().name())};
+            live_[match.id()] = live;
+            std::uint32_t position = 0;
+            for (const auto& event : match.events()) { addEvent(live.ordinal, live.home, live.away, position++, event); }
+            lock.unlock();
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) {
+            match.removeObserver(*this);
+            std::unique_lock lock(mutex_);
+            live_.erase(match.id());
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            std::unique_lock lock(mutex_);
+            const auto it = live_.find(match.id());
+            if (it == live_.end()) { return; }
+            const auto position = static_cast<std::uint32_t>(match.events().size() - 1);
+            addEvent(it->second.ordinal, it->second.home, it->second.away, position, event);
+        }
+
+        // Event numbers matching every predicate of the query, ascending
+        std::vector<std::uint32_t> matching(const EventQuery& query) const {
+            std::shared_lock lock(mutex_);
+            return matchingLocked(query);
+        }
+
+        std::size_t count(const EventQuery& query) const { return matching(query).size(); }
+
+        std::vector<EventHit> find(const EventQuery& query) const {
+            std::shared_lock lock(mutex_);
+            const auto numbers = matchingLocked(query);
+            std::vector<EventHit> hits;
+            hits.reserve(numbers.size());
+            for (const auto number : numbers) {
+                hits.push_back({matches_[match_of_[number]], position_of_[number]});
+            }
+            return hits;
+        }
+};
+
+// -----------------------------------------------------------------------------
+// ConversionTable – season-wide penalty-corner conversion per team
+// -----------------------------------------------------------------------------
+// Kept up to date as matches are played, at O(1) per event: each event only
+// adds the change in its team's counters since the previous event. Archived
+// matches are added from their final counters, without looking at the events.
+// Hosted matches update it from their own threads, so it takes its own lock.
+struct CornerConversion {
+    int corners = 0;
+    int goals = 0;
+
+    double rate() const noexcept { return corners == 0 ? 0.0 : static_cast<double>(goals) / corners; }
+};
+
+class ConversionTable : public MatchObserver {
+    private:
+        mutable std::shared_mutex mutex_; // guards everything below
+        // (season, team name) -> totals; std::map so a season's teams are adjacent
+        std::map<std::pair<std::uint16_t, std::string>, CornerConversion> teams_;
+        std::unordered_map<std::uint16_t, CornerConversion> seasons_;
+
+        struct Live {
+            std::uint16_t season;
+            CornerConversion* home;
+            CornerConversion* away;
+            CornerConversion seen_home, seen_away; // counters already added
+        };
+        std::unordered_map<std::uint32_t, Live> live_;
+
+        CornerConversion& entry(std::uint16_t season, const std::string& team) {
+            return teams_.try_emplace({season, team}).first->second;
+        }
+
+        void addCounters(std::uint16_t season, CornerConversion& team, const TeamCounters& counters,
+                         CornerConversion& seen) {
+            const int corners = counters.penalty_corners - seen.corners;
+            const int goals = counters.corner_goals - seen.goals;
+            team.corners += corners;
+            team.goals += goals;
+            seasons_[season].corners += corners;
+            seasons_[season].goals += goals;
+            seen = {counters.penalty_corners, counters.corner_goals};
+        }
+
+    public:
+        void add(const MatchRecord& record) {
+            std::unique_lock lock(mutex_);
+            CornerConversion none;
+            addCounters(record.key.season, entry(record.key.season, record.home_name), record.state.home, none);
+            none = {};
+            addCounters(record.key.season, entry(record.key.season, record.away_name), record.state.away, none);
+        }
+
+        void attach(HockeyMatch& match, std::uint16_t season) {
+            std::unique_lock lock(mutex_);
+            Live live{season, &entry(season, match.home().name()), &entry(season, match.away().name()), {}, {}};
+            addCounters(season, *live.home, match.home().counters(), live.seen_home);
+            addCounters(season, *live.away, match.away().counters(), live.seen_away);
+            live_[match.id()] = live;
+            lock.unlock();
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) {
+            match.removeObserver(*this);
+            std::unique_lock lock(mutex_);
+            live_.erase(match.id());
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            if (event.side() == Side::None) { return; }
+            std::unique_lock lock(mutex_);
+            const auto it = live_.find(match.id());
+            if (it == live_.end()) { return; }
+            Live& live = it->second;
+            if (event.side() == Side::Home) {
+                addCounters(live.season, *live.home, match.home().counters(), live.seen_home);
+            } else {
+                addCounters(live.season, *live.away, match.away().counters(), live.seen_away);
+            }
+        }
+
+
+        CornerConversion team(std::uint16_t season, const std::string& name) const {
+            std::shared_lock lock(mutex_);
+            const auto it = teams_.find({season, name});
+            return it == teams_.end() ? CornerConversion{} : it->second;
+        }
+
+        CornerConversion season(std::uint16_t season) const {
+            std::shared_lock lock(mutex_);
+            const auto it = seasons_.find(season);
+            return it == seasons_.end() ? CornerConversion{} : it->second;
+        }
+
+        // Every team that had a corner in the season, best conversion first
+        std::vector<std::pair<std::string, CornerConversion>> ranking(std::uint16_t season) const {
+            std::vector<std::pair<std::string, CornerConversion>> rows;
+            std::shared_lock lock(mutex_);
+            for (auto it = teams_.lower_bound({season, std::string()});
+                 it != teams_.end() && it->first.first == season; ++it) {
+                if (it->second.corners > 0) { rows.emplace_back(it->first.second, it->second); }
+            }
+            std::stable_sort(rows.begin(), rows.end(),
+                             [](const auto& a, const auto& b) { return a.second.rate() > b.second.rate(); });
+            return rows;
+        }
+};
+
+// -----------------------------------------------------------------------------
+// DisciplineTracker – card accumulation and suspensions across a tournament
+// -----------------------------------------------------------------------------
+// Teams get dense ids and players sit in a flat table at team * 100 + shirt
+// number, so a card is a couple of array updates. Each rule reads "every
+// `every` cards of `card` bans the player for the team's next `matches`
+// matches". Rules are checked as each card comes in. A ban is a range of the
+// team's fixture numbers: schedule() numbers each team's fixtures in order, so
+// eligible() is a hash lookup plus a comparison. Hosted matches run on several
+// threads, so the tracker takes its own lock; eligibility checks share it.
+struct SuspensionRule {
+    CardType card;
+    int every;   // this many cards of the type...
+    int matches; // ...ban the player for this many of the team's matches
+};
+
+class DisciplineTracker : public MatchObserver {
+    public:
+        static constexpr std::size_t kPlayersPerTeam = 100; // shirt numbers 0-99; 0 = not recorded
+
+    private:
+        struct Player {
+            std::array<std::uint16_t, static_cast<std::size_t>(CardType::Count)> cards{};
+            std::uint32_t banned_from = 0, banned_until = 0; // team fixture numbers [from, until)
+        };
+
+        struct Fixture {
+            std::uint32_t home, away;             // team ids
+            std::uint32_t home_index, away_index; // fixture number within each team's schedule
+        };
+
+        std::vector<SuspensionRule> rules_;
+
+        mutable std::shared_mutex mutex_; // guards everything below
+        std::unordered_map<std::string, std::uint32_t> team_ids_;
+        std::vector<std::uint32_t> fixtures_per_team_;
+        std::vector<std::array<std::uint32_t, static_cast<std::size_t>(CardType::Count)>> team_cards_;
+        std::vector<Player> players_; // team * kPlayersPerTeam + shirt number
+        std::unordered_map<std::uint32_t, Fixture> fixtures_; // by match id
+
+        std::uint32_t teamId(const std::string& name) {
+            const auto [it, added] = team_ids_.try_emplace(name, static_cast<std::uint32_t>(fixtures_per_team_.size()));
+            if (added) {
+                fixtures_per_team_.push_back(0);
+                team_cards_.emplace_back();
+                players_.resize(players_.size() + kPlayersPerTeam);
+            }
+            return it->second;
+        }
+
+        const Fixture& scheduleLocked(std::uint32_t match_id, const std::string& home, const std::string& away) {
+            if (const auto it = fixtures_.find(match_id); it != fixtures_.end()) { return it->second; }
+            const std::uint32_t h = teamId(home), a = teamId(away);
+            return fixtures_.try_emplace(match_id, Fixture{h, a, fixtures_per_team_[h]++, fixtures_per_team_[a]++})
+                .first->second;
+        }
+
+        void cardLocked(const Fixture& fixture, Side side, CardType type, std::uint8_t number) {
+            if (side == Side::None || type == CardType::Count) { return; }
+            const bool home = side == Side::Home;
+            const std::uint32_t team = home ? fixture.home : fixture.away;
+            const std::uint32_t played = home ? fixture.home_index : fixture.away_index;
+            const auto card = static_cast<std::size_t>(type);
+            ++team_cards_[team][card];
+            if (number == 0 || number >= kPlayersPerTeam) { return; }
+
+            Player& player = players_[team * kPlayersPerTeam + number];
+            const int count = ++player.cards[card];
+            for (const auto& rule : rules_) {
+                if (rule.card != type || count % rule.every != 0 || rule.matches == 0) { continue; }
+                // A new ban starts after this match; one still running is extended
+                const auto rule_matches = static_cast<std::uint32_t>(rule.matches);
+                if (player.banned_until > played) {
+                    player.banned_until += rule_matches;
+                } else {
+                    player.banned_from = played + 1;
+                    player.banned_until = played + 1 + rule_matches;
+                }
+            }
+        }
+
+        // Index into players_, or npos for unknown team/number
+        std::size_t playerSlot(const std::string& team, std::uint8_t number) const {
+            const auto it = team_ids_.find(team);
+            if (it == team_ids_.end() || number >= kPlayersPerTeam) { return std::string::npos; }
+            return it->second * kPlayersPerTeam + number;
+        }
+
+    public:
+        // Defaults: a red card is a one-match ban; so is every third yellow and every fifth green
+        explicit DisciplineTracker(std::vector<SuspensionRule> rules = {{CardType::Red, 1, 1},
+                                                                        {CardType::Yellow, 3, 1},
+                                                                        {CardType::Green, 5, 1}})
+            : rules_(std::move(rules)) {
+            for (const auto& rule : rules_) {
+                if (rule.every <= 0 || rule.matches < 0 || rule.card == CardType::Count) {
+                    throw std::invalid_argument("invalid suspension rule");
+                }
+            }
+        }
+
+        // Registers a fixture; each team's fixtures must be scheduled in the order they are played
+        void schedule(std::uint32_t match_id, const std::string& home, const std::string& away) {
+            std::unique_lock lock(mutex_);
+            scheduleLocked(match_id, home, away);
+        }
+
+        // Counts the cards of a match that is already over, e.g. one loaded
+        // from the season database; matches go in the order they were played
+        void add(const MatchRecord& record) {
+            std::unique_lock lock(mutex_);
+            const Fixture& fixture = scheduleLocked(record.key.match_id, record.home_name, record.away_name);
+            for (const auto& event : record.events) {
+                if (event.kind() == EventKind::Card) { cardLocked(fixture, event.side(), event.card(), event.player()); }
+            }
+        }
+
+        // Follows the match's cards, counting those it already has; schedules it first if needed
+        void attach(HockeyMatch& match) {
+            std::unique_lock lock(mutex_);
+            const Fixture& fixture = scheduleLocked(match.id(), match.home().name(), match.away().name());
+            for (const auto& event : match.events()) {
+                if (event.kind() == EventKind::Card) { cardLocked(fixture, event.side(), event.card(), event.player()); }
+            }
+            lock.unlock();
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) { match.removeObserver(*this); }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            if (event.kind() != EventKind::Card) { return; }
+            std::unique_lock lock(mutex_);
+            cardLocked(scheduleLocked(match.id(), match.home().name(), match.away().name()), event.side(), event.card(),
+                       event.player());
+        }
+
+        // May shirt `number` of `team` play in match `match_id`? Unknown fixtures and players are eligible.
+        bool eligible(const std::string& team, std::uint8_t number, std::uint32_t match_id) const {
+            std::shared_lock lock(mutex_);
+            const std::size_t slot = playerSlot(team, number);
+            const auto fixture = fixtures_.find(match_id);
+            if (slot == std::string::npos || fixture == fixtures_.end()) { return true; }
+            const std::uint32_t team_id = static_cast<std::uint32_t>(slot / kPlayersPerTeam);
+            std::uint32_t index = 0;
+            if (fixture->second.home == team_id) {
+                index = fixture->second.home_index;
+            } else if (fixture->second.away == team_id) {
+                index = fixture->second.away_index;
+            } else {
+                return true; // the team is not in that match
+            }
+            const Player& player = players_[slot];
+            return index < player.banned_from || index >= player.banned_until;
+        }
+
+        // How many of the team's matches after its last scheduled one the player must still sit out
+        int matchesBanned(const std::string& team, std::uint8_t number) const {
+            std::shared_lock lock(mutex_);
+            const std::size_t slot = playerSlot(team, number);
+            if (slot == std::string::npos) { return 0; }
+            const Player& player = players_[slot];
+            const std::uint32_t next = std::max(fixtures_per_team_[slot / kPlayersPerTeam], player.banned_from);
+            return player.banned_until > next ? static_cast<int>(player.banned_until - next) : 0;
+        }
+
+        int playerCards(const std::string& team, std::uint8_t number, CardType card) const {
+            std::shared_lock lock(mutex_);
+            const std::size_t slot = playerSlot(team, number);
+            if (slot == std::string::npos || card == CardType::Count) { return 0; }
+            return players_[slot].cards[static_cast<std::size_t>(card)];
+        }
+
+        // Every card the team received, including those without a player number
+        int teamCards(const std::string& team, CardType card) const {
+            std::shared_lock lock(mutex_);
+            const auto it = team_ids_.find(team);
+            if (it == team_ids_.end() || card == CardType::Count) { return 0; }
+            return static_cast<int>(team_cards_[it->second][static_cast<std::size_t>(card)]);
+        }
+};
+
+// -----------------------------------------------------------------------------
+// AsyncWriter – appends done by a background I/O thread
+// -----------------------------------------------------------------------------
+// append() copies the bytes into an in-memory ring and returns; it only waits
+// if the ring is full. The I/O thread takes everything queued since its last
+// pass, writes it with one writev() (two pieces when the ring wraps), and then
+// fsyncs once for the whole group. Records queued during an fsync ride along
+// with the next one, so a burst costs a few fsyncs instead of one per record.
+// The destructor writes and syncs whatever is still queued.
+class AsyncWriter {
+    private:
+        std::vector<char> ring_;
+        std::size_t mask_;
+        int fd_;
+        bool sync_;
+
+        std::mutex append_mutex_; // producers: one reservation at a time
+        std::atomic<std::uint64_t> head_{0};    // bytes queued
+        std::atomic<std::uint64_t> tail_{0};    // bytes written
+
+        std::mutex wake_mutex_;
+        std::condition_variable wake_;
+        std::atomic<bool> sleeping_{false};
+        std::atomic<bool> stop_{false};
+        std::atomic<bool> failed_{false}; // after a write error appends are dropped
+        std::string error_; // guarded by wake_mutex_
+
+        std::thread thread_;
+
+        void wakeWriter() {
+            if (sleeping_.load()) {
+                std::lock_guard lock(wake_mutex_);
+                wake_.notify_one();
+            }
+        }
+
+        void writeRing(std::uint64_t from, std::uint64_t to) {
+            HOCKEY_TRACE("journal.write");
+            const std::size_t begin = from & mask_;
+            const std::size_t length = static_cast<std::size_t>(to - from);
+            const std::size_t first = std::min(length, ring_.size() - begin);
+        #ifdef _WIN32
+            writeAll(fd_, std::string_view(ring_.data() + begin, first));
+            writeAll(fd_, std::string_view(ring_.data(), length - first));
+        #else
+            iovec iov[2] = {{ring_.data() + begin, first}, {ring_.data(), length - first}};
+            iovec* next = iov;
+            int count = length > first ? 2 : 1;
+            while (count > 0) {
+                const auto written = ::writev(fd_, next, count);
+                if (written < 0) {
+                    if (errno == EINTR) { continue; }
+                    throw std::runtime_error("journal write failed");
+                }
+                auto left = static_cast<std::size_t>(written);
+                while (count > 0 && left >= next->iov_len) {
+                    left -= next->iov_len;
+                    ++next;
+                    --count;
+                }
+                if (count > 0) {
+                    next->iov_base = static_cast<char*>(next->iov_base) + left;
+                    next->iov_len -= left;
+                }
+            }
+        #endif
+        }
+
+        void run() {
+            for (;;) {
+                const std::uint64_t head = head_.load();
+                const std::uint64_t tail = tail_.load();
+                if (head == tail) {
+                    std::unique_lock lock(wake_mutex_);
+                    if (stop_) { return; }
+                    sleeping_ = true;
+                    wake_.wait(lock, [&] { return stop_ || head_.load() != tail; });
+                    sleeping_ = false;
+                    continue;
+                }
+                try {
+                    writeRing(tail, head);
+                    tail_.store(head);
+                    tail_.notify_all(); // producers waiting for room
+                    if (sync_) { syncFile(fd_); }
+                } catch (const std::exception& e) {
+                    std::lock_guard lock(wake_mutex_);
+                    error_ = e.what();
+                    // Unblock everyone; the journal stops here
+                    failed_ = true;
+                    tail_.store(head);
+                    tail_.notify_all();
+                    stop_ = true;
+                    return;
+                }
+            }
+        }
+
+    public:
+        // Appends to fd (which the writer then owns). sync = fsync after each group.
+        explicit AsyncWriter(int fd, bool sync = true, std::size_t ring_bytes = std::size_t{4} << 20)
+            :   ring_(std::bit_ceil(std::max<std::size_t>(ring_bytes, 4096))),
+                mask_(ring_.size() - 1),
+                fd_(fd),
+                sync_(sync) {
+            thread_ = std::thread(&AsyncWriter::run, this);
+        }
+
+        AsyncWriter(const AsyncWriter&) = delete;
+        AsyncWriter& operator=(const AsyncWriter&) = delete;
+
+        // Writes and syncs everything queued before returning
+        ~AsyncWriter() {
+            {
+                std::lock_guard lock(wake_mutex_);
+                stop_ = true;
+                wake_.notify_one();
+            }
+            thread_.join();
+            ::close(fd_);
+        }
+
+        // Queues the bytes; after a write error they are dropped
+        void append(std::string_view data) {
+            if (data.size() > ring_.size()) { throw std::length_error("journal record larger than the ring"); }
+            std::lock_guard lock(append_mutex_);
+            const std::uint64_t head = head_.load(std::memory_order_relaxed);
+            for (std::uint64_t tail = tail_.load(); head + data.size() - tail > ring_.size(); tail = tail_.load()) {
+                if (failed_) { return; }
+                tail_.wait(tail); // ring full: the writer is behind the disk
+            }
+            if (failed_) { return; }
+            const std::size_t begin = head & mask_;
+            const std::size_t first = std::min(data.size(), ring_.size() - begin);
+            std::memcpy(ring_.data() + begin, data.data(), first);
+            std::memcpy(ring_.data(), data.data() + first, data.size() - first);
+            head_.store(head + data.size());
+            wakeWriter();
+        }
+
+        std::string error() {
+            std::lock_guard lock(wake_mutex_);
+            return error_;
+        }
+};
+
+
+// -----------------------------------------------------------------------------
+// MatchJournal – durable log of match events, written through an AsyncWriter
+// -----------------------------------------------------------------------------
+// Every record starts with a 16-byte little-endian header: match id, clock_ms,
+// type, then four type-specific bytes. An OpenMatch record has the two team
+// name lengths there, and the names follow the header. An Event record has
+// kind, side, card and player. A torn record at the end (crash while writing)
+// is ignored when replaying.
+class MatchJournal : public MatchObserver {
+    private:
+        static constexpr std::size_t kHeaderSize = 16;
+        enum class RecordType : std::uint8_t { OpenMatch = 0, Event = 1 };
+
+        bool fresh_ = false; // the file was empty when opened
+        AsyncWriter writer_;
+
+        static void putHeader(char* out, std::uint32_t match_id, std::uint32_t clock_ms, RecordType type,
+                              std::array<std::uint8_t, 4> extra) {
+            for (int i = 0; i < 4; ++i) {
+                out[i] = static_cast<char>(match_id >> (8 * i));
+                out[4 + i] = static_cast<char>(clock_ms >> (8 * i));
+            }
+            out[8] = static_cast<char>(type);
+            for (std::size_t i = 0; i < 4; ++i) { out[9 + i] = static_cast<char>(extra[i]); }
+            out[13] = out[14] = out[15] = 0;
+        }
+
+    public:
+        // Appends to the journal at `path`, or starts it afresh with truncate;
+        // sync = make each group durable with fsync
+        explicit MatchJournal(const std::string& path, bool sync = true, bool truncate = false)
+            : writer_([&] {
+                  const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | (truncate ? O_TRUNC : O_APPEND), 0644);
+                  if (fd < 0) { throw std::runtime_error("cannot open journal " + path); }
+                  fresh_ = ::lseek(fd, 0, SEEK_END) == 0;
+                  return fd;
+              }(), sync) {}
+
+        AsyncWriter& writer() noexcept { return writer_; }
+
+        // A fresh journal also gets the events the match already has (e.g. one
+        // taken over from a primary); a resumed one has them already
+        void attach(HockeyMatch& match) {
+            const std::string& home = match.home().name();
+            const std::string& away = match.away().name();
+            if (home.size() > 0xffff || away.size() > 0xffff) { throw std::length_error("team name too long to journal"); }
+            std::string record(kHeaderSize, '\0');
+            putHeader(record.data(), match.id(), 0, RecordType::OpenMatch,
+                      {static_cast<std::uint8_t>(home.size()), static_cast<std::uint8_t>(home.size() >> 8),
+                       static_cast<std::uint8_t>(away.size()), static_cast<std::uint8_t>(away.size() >> 8)});
+            record += home;
+            record += away;
+            writer_.append(record);
+            if (fresh_) {
+                for (const auto& event : match.events()) { onEvent(match, event); }
+            }
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) { match.removeObserver(*this); }
+
+        // No allocation: the record is built on the stack and copied into the ring
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            std::array<char, kHeaderSize> record;
+            putHeader(record.data(), match.id(), event.clockMs(), RecordType::Event,
+                      {static_cast<std::uint8_t>(event.kind()), static_cast<std::uint8_t>(event.side()),
+                       static_cast<std::uint8_t>(event.card()), event.player()});
+            writer_.append(std::string_view(record.data(), record.size()));
+        }
+
+        // Rebuilds every match in the journal
+        static std::map<std::uint32_t, HockeyMatch> replay(const std::string& path) {
+            std::map<std::uint32_t, HockeyMatch> matches;
+            const MappedFile file(path);
+            std::string_view data = file.view();
+            HockeyMatch* batch_match = nullptr;
+            std::vector<MatchAction> actions;
+            const auto flush = [&] {
+                if (batch_match != nullptr && !actions.empty()) { batch_match->applyBatch(actions); }
+                actions.clear();
+            };
+
+            while (data.size() >= kHeaderSize) {
+                const auto match_id = static_cast<std::uint32_t>(codec::getFixed(data.data(), 4));
+                const auto clock_ms = static_cast<std::uint32_t>(codec::getFixed(data.data() + 4, 4));
+                const auto type = static_cast<RecordType>(data[8]);
+                const auto byte = [&](std::size_t i) { return static_cast<std::uint8_t>(data[9 + i]); };
+
+                if (type == RecordType::OpenMatch) {
+                    const std::size_t home = byte(0) | (std::size_t{byte(1)} << 8);
+                    const std::size_t away = byte(2) | (std::size_t{byte(3)} << 8);
+                    if (data.size() < kHeaderSize + home + away) { break; } // torn
+                    flush();
+                    matches.try_emplace(match_id, std::string(data.substr(kHeaderSize, home)),
+                                        std::string(data.substr(kHeaderSize + home, away)), match_id);
+                    data.remove_prefix(kHeaderSize + home + away);
+                    continue;
+                }
+                if (type != RecordType::Event) { throw std::runtime_error("corrupt journal " + path); }
+
+                const auto it = matches.find(match_id);
+                if (it != matches.end()) {
+                    if (&it->second != batch_match) {
+                        flush();
+                        batch_match = &it->second;
+                    }
+                    if (const auto action = replayAction(byte(0), byte(1), byte(2), clock_ms, byte(3))) {
+                        actions.push_back(*action);
+                    }
+                }
+                data.remove_prefix(kHeaderSize);
+            }
+            flush();
+            for (auto& [id, match] : matches) {
+                match.continueClockFrom(match.events().back().clockMs()); // the clock carries on, not from 0
+            }
+            return matches;
+        }
+};
+
+// -----------------------------------------------------------------------------
+// WindowAnalytics – per-team event counts over windows of match time
+// -----------------------------------------------------------------------------
+// A window counts one kind of event (optionally one card colour) per team over
+// the last `length_ms` of match time, moving in steps of `slide_ms`. It keeps
+// a ring of length/slide partial counts plus a running total. A new step
+// subtracts the bucket falling out, so each event costs O(1) amortized.
+// slide == length gives a tumbling window, which counts the current period
+// only, e.g. "PCs in this 5-minute block". Each match has its own counters.
+// A match is only ever updated from one thread at a time (its own, or its
+// MatchHost strand), so the lock in each match's state is uncontended except
+// for readers.
+struct WindowSpec {
+    EventKind kind;
+    std::optional<CardType> card; // Card windows only: count just this colour
+    std::uint32_t length_ms;
+    std::uint32_t slide_ms;       // == length_ms for tumbling
+
+    static WindowSpec sliding(EventKind kind, std::uint32_t length_ms, std::uint32_t slide_ms = 1000) {
+        return {kind, std::nullopt, length_ms, slide_ms};
+    }
+    static WindowSpec tumbling(EventKind kind, std::uint32_t length_ms) {
+        return {kind, std::nullopt, length_ms, length_ms};
+    }
+};
+
+class WindowedCount {
+    private:
+        std::uint32_t slide_ms_;
+        std::vector<std::array<std::uint32_t, 2>> buckets_; // ring, by step number % size
+        std::array<std::uint32_t, 2> total_{};
+        std::uint64_t step_ = 0; // newest step the ring holds
+
+        // Moves the window forward so that `step` is the newest step
+        void advance(std::uint64_t step) {
+            if (step <= step_) { return; }
+            if (step - step_ >= buckets_.size()) { // everything falls out
+                std::fill(buckets_.begin(), buckets_.end(), std::array<std::uint32_t, 2>{});
+                total_ = {};
+            } else {
+                for (std::uint64_t s = step_ + 1; s <= step; ++s) {
+                    auto& bucket = buckets_[s % buckets_.size()];
+                    total_[0] -= bucket[0];
+                    total_[1] -= bucket[1];
+                    bucket = {};
+                }
+            }
+            step_ = step;
+        }
+
+    public:
+        WindowedCount(std::uint32_t length_ms, std::uint32_t slide_ms)
+            : slide_ms_(std::max<std::uint32_t>(slide_ms, 1)),
+              buckets_(std::max<std::size_t>(length_ms / slide_ms_, 1)) {}
+
+        void add(Side side, std::uint32_t clock_ms) {
+            const std::uint64_t step = clock_ms / slide_ms_;
+            advance(step);
+            if (step + buckets_.size() <= step_) { return; } // older than the window (replayed late)
+            const std::size_t team = side == Side::Home ? 0 : 1;
+            ++buckets_[step % buckets_.size()][team];
+            ++total_[team];
+        }
+
+        std::uint32_t count(Side side, std::uint32_t now_ms) {
+            advance(now_ms / slide_ms_);
+            return total_[side == Side::Home ? 0 : 1];
+        }
+};
+
+class WindowAnalytics : public MatchObserver {
+    private:
+        struct MatchWindows {
+            std::mutex mutex;
+            std::vector<WindowedCount> windows; // one per spec
+        };
+
+        std::vector<WindowSpec> specs_;
+        std::array<std::vector<std::size_t>, static_cast<std::size_t>(EventKind::Count)> specs_by_kind_;
+        mutable std::shared_mutex mutex_; // guards matches_ (the map, not the windows)
+        std::unordered_map<std::uint32_t, std::unique_ptr<MatchWindows>> matches_;
+
+        MatchWindows* find(std::uint32_t match_id) const {
+            std::shared_lock lock(mutex_);
+            const auto it = matches_.find(match_id);
+            return it == matches_.end() ? nullptr : it->second.get();
+        }
+
+    public:
+        explicit WindowAnalytics(std::vector<WindowSpec> specs) : specs_(std::move(specs)) {
+            for (std::size_t i = 0; i < specs_.size(); ++i) {
+                if (specs_[i].kind == EventKind::Count || specs_[i].slide_ms == 0 || specs_[i].length_ms < specs_[i].slide_ms) {
+                    throw std::invalid_argument("invalid window");
+                }
+                specs_by_kind_[static_cast<std::size_t>(specs_[i].kind)].push_back(i);
+            }
+        }
+
+        const std::vector<WindowSpec>& specs() const noexcept { return specs_; }
+
+        // Counts from now on; events already in the match are replayed into the windows
+        void attach(HockeyMatch& match) {
+            auto state = std::make_unique<MatchWindows>();
+            state->windows.reserve(specs_.size());
+            for (const auto& spec : specs_) { state->windows.emplace_back(spec.length_ms, spec.slide_ms); }
+            {
+                std::unique_lock lock(mutex_);
+                matches_[match.id()] = std::move(state);
+            }
+            for (const auto& event : match.events()) { onEvent(match, event); }
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) {
+            match.removeObserver(*this);
+            std::unique_lock lock(mutex_);
+            matches_.erase(match.id());
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            if (event.side() == Side::None) { return; }
+            const auto& interested = specs_by_kind_[static_cast<std::size_t>(event.kind())];
+            if (interested.empty()) { return; }
+            MatchWindows* state = find(match.id());
+            if (state == nullptr) { return; }
+            std::lock_guard lock(state->mutex);
+            for (const std::size_t i : interested) {
+                if (specs_[i].card && *specs_[i].card != event.card()) { continue; }
+                state->windows[i].add(event.side(), event.clockMs());
+            }
+        }
+
+        // Count for window `spec` (index into specs()) as of match time now_ms.
+        // Windows only move forward: an earlier now_ms reads the newest window.
+        std::uint32_t count(std::uint32_t match_id, std::size_t spec, Side side, std::uint32_t now_ms) const {
+            MatchWindows* state = find(match_id);
+            if (state == nullptr || spec >= specs_.size()) { return 0; }
+            std::lock_guard lock(state->mutex);
+            return state->windows[spec].count(side, now_ms);
+        }
+};
+
+// -----------------------------------------------------------------------------
+// PatternEngine – live alerts from declarative event patterns
+// -----------------------------------------------------------------------------
+// A pattern is a sequence of steps, each matching one event, seen from one
+// team (the subject). Examples:
+//   3 PCs in 2 minutes:         PatternSpec::repeated("PC burst", {EventKind::PenaltyCorner}, 3, 120000)
+//   second yellow in a quarter: PatternSpec::repeated("2nd yellow", {EventKind::Card, CardType::Yellow}, 2, 0, true)
+//   comeback from 2 down:       {"comeback", {{EventKind::Goal, {}, PatternSide::Opponent, {}, -2},
+//                                             {EventKind::Goal, {}, PatternSide::Subject, 0}}}
+// Each pattern compiles to a chain automaton run for both teams. State s holds
+// the start time of the newest partial match that has passed s steps; the
+// newest start is all that matters, since it is the last to run out of
+// `within_ms`. An event is tried against every state from the last down, so
+// it advances a run by at most one step. A pattern whose steps all take
+// PatternSide::Any and no lead has no subject: both teams' runs would be the
+// same, so it runs once and alerts once, with Side::None. All state for a
+// match is one flat array allocated by attach(), so onEvent() never allocates.
+enum class PatternSide : unsigned char { Subject = 0, Opponent, Any };
+
+struct PatternStep {
+    EventKind kind;
+    std::optional<CardType> card;             // Card steps only: this colour
+    PatternSide side = PatternSide::Subject;  // who the event belongs to
+    std::optional<int> min_lead;              // subject's goal lead after the event
+    std::optional<int> max_lead;
+};
+
+struct PatternSpec {
+    std::string name;
+    std::vector<PatternStep> steps;
+    std::uint32_t within_ms = 0; // first to last step, in match time; 0 = no limit
+    bool per_quarter = false;    // partial matches do not carry over a quarter break
+
+    static PatternSpec repeated(std::string name, PatternStep step, std::size_t times,
+                                std::uint32_t within_ms, bool per_quarter = false) {
+        return {std::move(name), std::vector<PatternStep>(times, step), within_ms, per_quarter};
+    }
+};
+
+struct PatternAlert {
+    std::uint32_t match_id;
+    std::size_t pattern; // index into PatternEngine::patterns()
+    Side side;           // the subject team; Side::None if the pattern has no subject
+    std::uint32_t clock_ms;
+};
+
+class PatternEngine : public MatchObserver {
+    public:
+        // Called from whichever thread feeds the match, so it must be thread-safe
+        // if matches are updated concurrently (e.g. on a MatchHost)
+        using AlertHandler = std::function<void(const PatternAlert&)>;
+
+    private:
+        static constexpr std::uint32_t kNoRun = std::numeric_limits<std::uint32_t>::max();
+
+        struct Compiled {
+            std::size_t offset; // of this pattern's states for Home; Away follows
+            std::size_t steps;
+            bool subjectless;   // one run, not one per team
+        };
+
+        std::vector<PatternSpec> patterns_;
+        std::vector<Compiled> compiled_;
+        std::size_t states_per_match_ = 0;
+        std::array<std::vector<std::size_t>, static_cast<std::size_t>(EventKind::Count)> by_kind_;
+        std::vector<std::size_t> per_quarter_;
+        AlertHandler handler_;
+        mutable std::shared_mutex mutex_; // guards matches_; each match's states belong to its thread
+        std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> matches_;
+
+        static bool matches(const PatternStep& step, Side subject, const HockeyMatch& match, const MatchEvent& event) {
+            if (step.kind != event.kind()) { return false; }
+            if (step.card && *step.card != event.card()) { return false; }
+            if (step.side != PatternSide::Any &&
+                (event.side() == subject) != (step.side == PatternSide::Subject)) {
+                return false;
+            }
+            if (step.min_lead || step.max_lead) {
+                const int lead = subject == Side::Home ? match.home().goals() - match.away().goals()
+                                                       : match.away().goals() - match.home().goals();
+                if (step.min_lead && lead < *step.min_lead) { return false; }
+                if (step.max_lead && lead > *step.max_lead) { return false; }
+            }
+            return true;
+        }
+
+        // Runs pattern p for one subject team; `runs` are its per-state start times
+        bool step(std::size_t p, Side subject, std::uint32_t* runs, const HockeyMatch& match, const MatchEvent& event) const {
+            const PatternSpec& spec = patterns_[p];
+            const std::size_t n = compiled_[p].steps;
+            const std::uint32_t now = event.clockMs();
+            for (std::size_t s = n; s-- > 0;) {
+                const std::uint32_t start = s == 0 ? now : runs[s - 1];
+                if (start == kNoRun) { continue; }
+                if (spec.within_ms != 0 && now - start > spec.within_ms) {
+                    runs[s - 1] = kNoRun; // s > 0 here: a fresh start never runs out
+                    continue;
+                }
+                if (!matches(spec.steps[s], subject, match, event)) { continue; }
+                if (s + 1 == n) {
+                    std::fill(runs, runs + n - 1, kNoRun); // matches do not overlap
+                    return true;
+                }
+                runs[s] = runs[s] == kNoRun ? start : std::max(runs[s], start);
+            }
+            return false;
+        }
+
+    public:
+        PatternEngine(std::vector<PatternSpec> patterns, AlertHandler handler)
+            : patterns_(std::move(patterns)), handler_(std::move(handler)) {
+            for (std::size_t p = 0; p < patterns_.size(); ++p) {
+                const PatternSpec& spec = patterns_[p];
+                if (spec.steps.empty()) {
+                    throw std::invalid_argument("pattern '" + spec.name + "' has no steps");
+                }
+                const bool subjectless = std::ranges::all_of(spec.steps, [](const PatternStep& step) {
+                    return step.side == PatternSide::Any && !step.min_lead && !step.max_lead;
+                });
+                // Only the states between steps are stored: n steps need n - 1 per run
+                compiled_.push_back({states_per_match_, spec.steps.size(), subjectless});
+                states_per_match_ += (subjectless ? 1 : 2) * (spec.steps.size() - 1);
+                std::array<bool, static_cast<std::size_t>(EventKind::Count)> seen{};
+                for (const auto& step : spec.steps) {
+                    if (step.kind == EventKind::Count) {
+                        throw std::invalid_argument("pattern '" + spec.name + "' has an invalid step");
+                    }
+                    if (!std::exchange(seen[static_cast<std::size_t>(step.kind)], true)) {
+                        by_kind_[static_cast<std::size_t>(step.kind)].push_back(p);
+                    }
+                }
+                if (spec.per_quarter) { per_quarter_.push_back(p); }
+            }
+        }
+
+        const std::vector<PatternSpec>& patterns() const noexcept { return patterns_; }
+
+        // Events already in the match are not replayed: alerts are for what happens next
+        void attach(HockeyMatch& match) {
+            {
+                std::unique_lock lock(mutex_);
+                matches_[match.id()].assign(states_per_match_, kNoRun);
+            }
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) {
+            match.removeObserver(*this);
+            std::unique_lock lock(mutex_);
+            matches_.erase(match.id());
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            std::uint32_t* states = nullptr;
+            {
+                std::shared_lock lock(mutex_);
+                const auto it = matches_.find(match.id());
+                if (it == matches_.end()) { return; }
+                states = it->second.data();
+            }
+            if (event.kind() == EventKind::QuarterStart || event.kind() == EventKind::QuarterEnd) {
+                for (const std::size_t p : per_quarter_) {
+                    const std::size_t kept = compiled_[p].steps - 1;
+                    std::fill_n(states + compiled_[p].offset, (compiled_[p].subjectless ? 1 : 2) * kept, kNoRun);
+                }
+            }
+            for (const std::size_t p : by_kind_[static_cast<std::size_t>(event.kind())]) {
+                const std::size_t kept = compiled_[p].steps - 1;
+                std::uint32_t* runs = states + compiled_[p].offset;
+                if (compiled_[p].subjectless) {
+                    if (step(p, Side::Home, runs, match, event) && handler_) {
+                        handler_({match.id(), p, Side::None, event.clockMs()});
+                    }
+                    continue;
+                }
+                for (const Side subject : {Side::Home, Side::Away}) {
+                    if (step(p, subject, runs, match, event) && handler_) {
+                        handler_({match.id(), p, subject, event.clockMs()});
+                    }
+                    runs += kept;
+                }
+            }
+        }
+};
+
+// -----------------------------------------------------------------------------
+// EventBus – event subscriptions filtered at the publisher
+// -----------------------------------------------------------------------------
+// A subscriber states which events it wants: kinds, teams (by name), sides,
+// card colours, one match, or matches carrying some tags (e.g. kTelevised).
+// subscribe() compiles the filter into bitmasks and files the subscriber
+// under each kind it wants, in the narrowest index the filter allows: its
+// match, its team, the lowest tag it requires, or each side it wants. Only a
+// filter with none of these goes under all matches. A published event visits
+// only the subscribers filed under its kind and its match, team, side or one
+// of the match's tags, tests them with a few AND operations, and never
+// touches the rest.
+struct EventFilter {
+    std::vector<EventKind> kinds;             // empty = every kind
+    std::vector<Side> sides;                  // empty = every side, including Side::None
+    std::vector<CardType> cards;              // Card events only; empty = every colour
+    std::optional<std::string> team;          // events of this team only
+    std::optional<std::uint32_t> match_id;
+    std::uint32_t match_tags = 0;             // the match must carry all of these
+};
+
+class EventBus : public MatchObserver {
+    public:
+        using SubscriptionId = std::uint64_t;
+        using Handler = std::function<void(const HockeyMatch&, const MatchEvent&)>;
+
+        static constexpr std::uint32_t kTelevised = 1u << 0;
+
+    private:
+        static constexpr std::size_t kKinds = static_cast<std::size_t>(EventKind::Count);
+        static constexpr std::uint32_t kNoTeam = std::numeric_limits<std::uint32_t>::max();
+
+        struct Subscriber {
+            SubscriptionId id;
+            std::uint8_t sides;     // bit per Side
+            std::uint8_t cards;     // bit per CardType, CardType::Count = not a card
+            std::uint32_t tags;
+            std::uint32_t team;     // interned name, kNoTeam = any
+            Handler handler;
+        };
+        using KindIndex = std::array<std::vector<const Subscriber*>, kKinds>;
+
+        struct MatchInfo {
+            std::uint32_t tags = 0;
+            std::array<std::uint32_t, 2> teams{}; // interned home, away
+        };
+
+        mutable std::shared_mutex mutex_;
+        std::unordered_map<SubscriptionId, std::unique_ptr<Subscriber>> subscribers_;
+        KindIndex all_matches_;
+        std::unordered_map<std::uint32_t, KindIndex> by_match_;
+        std::unordered_map<std::uint32_t, KindIndex> by_team_;
+        std::unordered_map<std::uint32_t, KindIndex> by_tag_; // by tag bit number
+        std::array<KindIndex, 3> by_side_;                     // by Side
+        std::unordered_map<std::string, std::uint32_t> team_ids_;
+        std::unordered_map<std::uint32_t, MatchInfo> matches_;
+        SubscriptionId next_id_ = 1;
+
+        static constexpr std::uint8_t bit(Side side) noexcept { return std::uint8_t(1u << static_cast<unsigned>(side)); }
+        static constexpr std::uint8_t bit(CardType card) noexcept { return std::uint8_t(1u << static_cast<unsigned>(card)); }
+
+        // Caller holds mutex_ exclusively
+        std::uint32_t intern(const std::string& team) {
+            return team_ids_.try_emplace(team, static_cast<std::uint32_t>(team_ids_.size())).first->second;
+        }
+
+        // Where the subscriber is filed; a side filter files it once per side it wants
+        std::vector<KindIndex*> indexesFor(const EventFilter& filter, const Subscriber& sub) {
+            if (filter.match_id) { return {&by_match_[*filter.match_id]}; }
+            if (sub.team != kNoTeam) { return {&by_team_[sub.team]}; }
+            if (sub.tags != 0) { return {&by_tag_[static_cast<std::uint32_t>(std::countr_zero(sub.tags))]}; }
+            std::vector<KindIndex*> indexes;
+            for (const Side side : {Side::None, Side::Home, Side::Away}) {
+                if (sub.sides & bit(side)) { indexes.push_back(&by_side_[static_cast<std::size_t>(side)]); }
+            }
+            if (indexes.size() == by_side_.size()) { return {&all_matches_}; }
+            return indexes;
+        }
+
+        static void deliver(const std::vector<const Subscriber*>& candidates, const MatchInfo& info,
+                            const HockeyMatch& match, const MatchEvent& event) {
+            const std::uint8_t side = bit(event.side());
+            const std::uint8_t card = bit(event.card());
+            const std::uint32_t team = event.side() == Side::Home ? info.teams[0]
+                                     : event.side() == Side::Away ? info.teams[1] : kNoTeam;
+            for (const Subscriber* sub : candidates) {
+                if ((sub->sides & side) && (sub->cards & card) && (info.tags & sub->tags) == sub->tags &&
+                    (sub->team == kNoTeam || sub->team == team)) {
+                    sub->handler(match, event);
+                }
+            }
+        }
+
+    public:
+        // The handler runs on the thread that feeds the match, with the bus
+        // locked for reading: it must not subscribe or unsubscribe.
+        SubscriptionId subscribe(const EventFilter& filter, Handler handler) {
+            auto sub = std::make_unique<Subscriber>();
+            sub->sides = 0;
+            for (const Side side : filter.sides) { sub->sides |= bit(side); }
+            if (filter.sides.empty()) { sub->sides = bit(Side::Home) | bit(Side::Away) | bit(Side::None); }
+            sub->cards = bit(CardType::Count); // non-card events carry CardType::Count
+            for (const CardType card : filter.cards) { sub->cards |= bit(card); }
+            if (filter.cards.empty()) { sub->cards = 0xFF; }
+            sub->tags = filter.match_tags;
+            sub->handler = std::move(handler);
+
+            std::unique_lock lock(mutex_);
+            sub->team = filter.team ? intern(*filter.team) : kNoTeam;
+            sub->id = next_id_++;
+            for (KindIndex* index : indexesFor(filter, *sub)) {
+                for (std::size_t k = 0; k < kKinds; ++k) {
+                    if (filter.kinds.empty() || std::ranges::find(filter.kinds, EventKind(k)) != filter.kinds.end()) {
+                        (*index)[k].push_back(sub.get());
+                    }
+                }
+            }
+            const SubscriptionId id = sub->id;
+            subscribers_.emplace(id, std::move(sub));
+            return id;
+        }
+
+        void unsubscribe(SubscriptionId id) {
+            std::unique_lock lock(mutex_);
+            const auto it = subscribers_.find(id);
+            if (it == subscribers_.end()) { return; }
+            const Subscriber* sub = it->second.get();
+            const auto drop = [sub](KindIndex& index) {
+                for (auto& list : index) { std::erase(list, sub); }
+            };
+            drop(all_matches_);
+            for (auto& [match_id, index] : by_match_) { drop(index); }
+            for (auto& [team, index] : by_team_) { drop(index); }
+            for (auto& [tag, index] : by_tag_) { drop(index); }
+            for (auto& index : by_side_) { drop(index); }
+            subscribers_.erase(it);
+        }
+
+        // tags: e.g. kTelevised; matches not attached publish nothing
+        void attach(HockeyMatch& match, std::uint32_t tags = 0) {
+            {
+                std::unique_lock lock(mutex_);
+                matches_[match.id()] = {tags, {intern(match.home().name()), intern(match.away().name())}};
+            }
+            match.addObserver(*this);
+        }
+
+        void detach(HockeyMatch& match) {
+            match.removeObserver(*this);
+            std::unique_lock lock(mutex_);
+            matches_.erase(match.id());
+        }
+
+        void onEvent(const HockeyMatch& match, const MatchEvent& event) override {
+            const std::size_t kind = static_cast<std::size_t>(event.kind());
+            std::shared_lock lock(mutex_);
+            const auto info = matches_.find(match.id());
+            if (info == matches_.end()) { return; }
+            deliver(all_matches_[kind], info->second, match, event);
+            deliver(by_side_[static_cast<std::size_t>(event.side())][kind], info->second, match, event);
+            for (std::uint32_t tags = info->second.tags; tags != 0; tags &= tags - 1) {
+                if (const auto it = by_tag_.find(static_cast<std::uint32_t>(std::countr_zero(tags))); it != by_tag_.end()) {
+                    deliver(it->second[kind], info->second, match, event);
+                }
+            }
+            if (const auto it = by_match_.find(match.id()); it != by_match_.end()) {
+                deliver(it->second[kind], info->second, match, event);
+            }
+            // Only the team the event belongs to can match a team filter
+            if (event.side() != Side::None) {
+                const std::uint32_t team = info->second.teams[event.side() == Side::Home ? 0 : 1];
+                if (const auto it = by_team_.find(team); it != by_team_.end()) {
+                    deliver(it->second[kind], info->second, match, event);
+                }
+            }
+        }
+};
+
+// -----------------------------------------------------------------------------
+// MatchView – offset-based binary image of a whole match, read in place
 // -----------------------------------------------------------------------------
-class Team {
-    private: // underscores distinguish private member variables from local variables
-        std::string name_;
-        int goals_ = 0, green_ = 0, yellow_ = 0, red_ = 0, penalty_corners_ = 0;
+// MatchView::encode() writes a match as one flat image; a MatchView over
+// those bytes (an mmap, a network buffer) reads any field straight from
+// them: no parsing, no copies, no allocation. Integers are little endian
+// and read byte-wise, so the image needs no alignment.
+//
+// Layout v1, offsets from the start of the image:
+//    0 magic "HKMV"         4 version u16          6 header_size u16
+//    8 image_size u32      12 match_id u32         16 quarter u8
+//   17 finished u8         18 event_stride u16     20 event_count u32
+//   24 events_off u32      28 home team            60 away team
+//   team (32 bytes): name_off u32, name_len u32, then goals, green, yellow,
+//                    red, penalty_corners, corner_goals as u32
+//   event (event_stride bytes, 16 in v1): clock_ms u32, text_off u32,
+//                    text_len u16, quarter, kind, side, card, player u8, 1 spare
+//   strings follow the events.
+// Versioning: new fields are only ever appended to the header or to the event
+// record, growing header_size / event_stride, so older readers skip them.
+// Anything else bumps `version`, which readers refuse if it is newer.
+class MatchView {
+    public:
+        static constexpr std::uint16_t kVersion = 1;
+
+    private:
+        static constexpr std::string_view kMagic = "HKMV";
+        static constexpr std::size_t kHeaderSize = 92;
+        static constexpr std::size_t kTeamSize = 32;
+        static constexpr std::size_t kEventSize = 16;
+
+        std::string_view image_;
+        std::size_t event_stride_ = 0;
+        std::size_t event_count_ = 0;
+        std::size_t events_off_ = 0;
+
+        std::uint64_t fixed(std::size_t at, int bytes) const noexcept { return codec::getFixed(image_.data() + at, bytes); }
+
+        std::string_view text(std::size_t at) const {
+            const std::size_t off = fixed(at, 4);
+            const std::size_t len = fixed(at + 4, 4);
+            if (off > image_.size() || len > image_.size() - off) {
+                throw std::runtime_error("match image: string out of bounds");
+            }
+            return image_.substr(off, len);
+        }
+
+        static void putTeam(std::string& out, std::size_t name_off, const Team& team) {
+            codec::putFixed(out, name_off, 4);
+            codec::putFixed(out, team.name().size(), 4);
+            for (const int value : {team.goals(), team.greenCards(), team.yellowCards(), team.redCards(),
+                                    team.penaltyCorners(), team.cornerGoals()}) {
+                codec::putFixed(out, static_cast<std::uint32_t>(value), 4);
+            }
+        }
 
     public:
-        explicit Team(std::string name) : name_(std::move(name)) {}
-        // "Create a Team from a string. Do not allow implicit conversion.
-        
-        const std::string& name() const noexcept    { return name_; }
-        int goals() const noexcept                  { return goals_; }
-        int penaltyCorners() const noexcept         { return penalty_corners_; }
+        class TeamView {
+            private:
+                const MatchView* view_;
+                std::size_t at_;
 
-        int greenCards() const noexcept             { return green_; }
-        int yellowCards() const noexcept            { return yellow_; }
-        int redCards() const noexcept               { return red_; }
-    
+            public:
+                TeamView(const MatchView& view, std::size_t at) : view_(&view), at_(at) {}
 
-        // actions - state changes
-        void scoreGoal() noexcept { ++goals_; }
-        void awardPenaltyCorner() noexcept { ++penalty_corners_; }
+                std::string_view name() const { return view_->text(at_); }
+                int goals() const noexcept          { return static_cast<int>(view_->fixed(at_ + 8, 4)); }
+                int greenCards() const noexcept     { return static_cast<int>(view_->fixed(at_ + 12, 4)); }
+                int yellowCards() const noexcept    { return static_cast<int>(view_->fixed(at_ + 16, 4)); }
+                int redCards() const noexcept       { return static_cast<int>(view_->fixed(at_ + 20, 4)); }
+                int penaltyCorners() const noexcept { return static_cast<int>(view_->fixed(at_ + 24, 4)); }
+                int cornerGoals() const noexcept    { return static_cast<int>(view_->fixed(at_ + 28, 4)); }
 
-        void receiveCard(CardType type) noexcept {
-            switch (type) {
-                case CardType::Green:  ++green_; break;
-                case CardType::Yellow: ++yellow_; break;
-                case CardType::Red:    ++red_; break;
-                case CardType::Count:  break;
+                TeamCounters counters() const noexcept {
+                    return {goals(), greenCards(), yellowCards(), redCards(), penaltyCorners(), cornerGoals()};
+                }
+        };
+
+        class EventView {
+            private:
+                const MatchView* view_;
+                std::size_t at_;
+
+                std::uint8_t byte(std::size_t i) const noexcept { return static_cast<std::uint8_t>(view_->image_[at_ + i]); }
+
+            public:
+                EventView(const MatchView& view, std::size_t at) : view_(&view), at_(at) {}
+
+                std::uint32_t clockMs() const noexcept { return static_cast<std::uint32_t>(view_->fixed(at_, 4)); }
+                int quarter() const noexcept            { return byte(10); }
+                EventKind kind() const noexcept         { return static_cast<EventKind>(byte(11)); }
+                Side side() const noexcept              { return static_cast<Side>(byte(12)); }
+                CardType card() const noexcept          { return static_cast<CardType>(byte(13)); }
+                std::uint8_t player() const noexcept    { return byte(14); }
+
+                std::string_view description() const {
+                    const std::size_t off = view_->fixed(at_ + 4, 4);
+                    const std::size_t len = view_->fixed(at_ + 8, 2);
+                    if (off > view_->image_.size() || len > view_->image_.size() - off) {
+                        throw std::runtime_error("match image: string out of bounds");
+                    }
+                    return view_->image_.substr(off, len);
+                }
+        };
+
+        // Checks the header and that the event table fits; throws if not.
+        // The image must outlive the view.
+        explicit MatchView(std::string_view image) : image_(image) {
+            if (image_.size() < kHeaderSize || image_.substr(0, 4) != kMagic) {
+                throw std::runtime_error("not a match image");
+            }
+            if (version() > kVersion) {
+                throw std::runtime_error("match image version " + std::to_string(version()) + " is newer than this reader");
             }
+            const std::size_t header_size = fixed(6, 2);
+            const std::size_t image_size = fixed(8, 4);
+            event_stride_ = fixed(18, 2);
+            event_count_ = fixed(20, 4);
+            events_off_ = fixed(24, 4);
+            if (header_size < kHeaderSize || event_stride_ < kEventSize || image_size > image_.size() ||
+                events_off_ < header_size || events_off_ > image_size ||
+                event_count_ > (image_size - events_off_) / event_stride_) {
+                throw std::runtime_error("corrupt match image");
+            }
+            image_ = image_.substr(0, image_size);
         }
 
-        // formatted summary:
-        std::string statsLine() const {
-            std::ostringstream oss;
-            oss << green_ << "G "
-                << yellow_ << "Y "
-                << red_ << "R "
-                << penalty_corners_ << "PC";
-            return oss.str();
-        }  
+        static void encode(std::string& out, const HockeyMatch& match) {
+            const EventLog& events = match.events();
+            const std::size_t base = out.size();
+            const std::size_t events_off = kHeaderSize;
+            const std::size_t strings_off = events_off + events.size() * kEventSize;
+            std::size_t image_size = strings_off + match.home().name().size() + match.away().name().size();
+            for (const auto& event : events) {
+                image_size += std::min<std::size_t>(event.description().size(), 0xFFFF);
+            }
+            if (image_size > std::numeric_limits<std::uint32_t>::max()) {
+                throw std::length_error("match too large for a match image");
+            }
+            out.reserve(base + image_size);
+
+            out.append(kMagic);
+            codec::putFixed(out, kVersion, 2);
+            codec::putFixed(out, kHeaderSize, 2);
+            codec::putFixed(out, image_size, 4);
+            codec::putFixed(out, match.id(), 4);
+            out.push_back(static_cast<char>(match.quarter()));
+            out.push_back(static_cast<char>(match.finished()));
+            codec::putFixed(out, kEventSize, 2);
+            codec::putFixed(out, events.size(), 4);
+            codec::putFixed(out, events_off, 4);
+            std::size_t text_off = strings_off;
+            putTeam(out, text_off, match.home());
+            text_off += match.home().name().size();
+            putTeam(out, text_off, match.away());
+            text_off += match.away().name().size();
+
+            for (const auto& event : events) {
+                const std::size_t len = std::min<std::size_t>(event.description().size(), 0xFFFF);
+                codec::putFixed(out, event.clockMs(), 4);
+                codec::putFixed(out, text_off, 4);
+                codec::putFixed(out, len, 2);
+                out.push_back(static_cast<char>(event.quarter()));
+                out.push_back(static_cast<char>(event.kind()));
+                out.push_back(static_cast<char>(event.side()));
+                out.push_back(static_cast<char>(event.card()));
+                out.push_back(static_cast<char>(event.player()));
+                out.push_back('\0');
+                text_off += len;
+            }
+            out.append(match.home().name());
+            out.append(match.away().name());
+            for (const auto& event : events) {
+                out.append(event.description().substr(0, 0xFFFF));
+            }
+        }
+
+        std::uint16_t version() const noexcept  { return static_cast<std::uint16_t>(fixed(4, 2)); }
+        std::uint32_t matchId() const noexcept  { return static_cast<std::uint32_t>(fixed(12, 4)); }
+        int quarter() const noexcept            { return static_cast<unsigned char>(image_[16]); }
+        bool finished() const noexcept          { return image_[17] != 0; }
+        std::string_view bytes() const noexcept { return image_; }
+
+        TeamView home() const noexcept { return {*this, 28}; }
+        TeamView away() const noexcept { return {*this, 28 + kTeamSize}; }
+
+        ScoreboardState state() const noexcept { return {home().counters(), away().counters(), quarter()}; }
+
+        std::size_t eventCount() const noexcept { return event_count_; }
+        EventView event(std::size_t i) const noexcept { return {*this, events_off_ + i * event_stride_}; }
+
+        // A live HockeyMatch with the same teams and events (at their recorded match time)
+        HockeyMatch restore() const {
+            HockeyMatch match(std::string(home().name()), std::string(away().name()), matchId());
+            std::vector<MatchAction> actions;
+            actions.reserve(event_count_);
+            for (std::size_t i = 0; i < event_count_; ++i) {
+                const EventView event = this->event(i);
+                if (const auto action = replayAction(static_cast<std::uint8_t>(event.kind()), static_cast<std::uint8_t>(event.side()),
+                                                     static_cast<std::uint8_t>(event.card()), event.clockMs(), event.player())) {
+                    actions.push_back(*action);
+                }
+            }
+            match.applyBatch(actions);
+            return match;
+        }
 };
 
+// display things
+static void clearScreen(OutputSink& out) {
+    HOCKEY_TRACE("clearScreen");
+    #ifdef _WIN32
+        out.flush();
+        std::system("cls");
+    #else
+        out.write("\x1B[2J\x1B[H");
+    #endif
+    }
+
+// Shows whatever is buffered, then waits so the user can read it
+static void pauseFor(OutputSink& out, std::chrono::milliseconds delay) {
+    out.flush();
+    std::this_thread::sleep_for(delay);
+}
+
 // -----------------------------------------------------------------------------
-// Small value class representing a single event in the match timeline
+// SeqLock – single-writer snapshot that readers copy without blocking it
 // -----------------------------------------------------------------------------
-class MatchEvent {
+// The writer bumps the sequence to odd, stores, bumps to even; a reader retries
+// if it saw an odd sequence or the sequence moved while it copied.
+template <typename T>
+class SeqLock {
     private:
-        int quarter_;
-        std::string description_;
+        static_assert(std::is_trivially_copyable_v<T>);
+        static constexpr std::size_t kWords = (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+        std::atomic<std::uint64_t> sequence_{0};
+        std::array<std::atomic<std::uint64_t>, kWords> words_{};
 
     public:
-        // constructor:
-        MatchEvent(int quarter, std::string description) :
-            quarter_(quarter), description_(std::move(description)) {}
+        void store(const T& value) noexcept {
+            std::array<std::uint64_t, kWords> raw{};
+            std::memcpy(raw.data(), &value, sizeof(T));
+            const std::uint64_t sequence = sequence_.load(std::memory_order_relaxed);
+            sequence_.store(sequence + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            for (std::size_t i = 0; i < kWords; ++i) {
+                words_[i].store(raw[i], std::memory_order_relaxed);
+            }
+            sequence_.store(sequence + 2, std::memory_order_release);
+        }
 
-        std::string toString() const {
-            std::ostringstream oss;
-            oss << "Q" << quarter_ << " - " << description_;
-            return oss.str();
+        T load() const noexcept {
+            std::array<std::uint64_t, kWords> raw{};
+            std::uint64_t before = 0, after = 0;
+            do {
+                before = sequence_.load(std::memory_order_acquire);
+                for (std::size_t i = 0; i < kWords; ++i) {
+                    raw[i] = words_[i].load(std::memory_order_relaxed);
+                }
+                std::atomic_thread_fence(std::memory_order_acquire);
+                after = sequence_.load(std::memory_order_relaxed);
+            } while ((before & 1) != 0 || before != after);
+
+            T value;
+            std::memcpy(static_cast<void*>(&value), raw.data(), sizeof(T));
+            return value;
         }
 };
 
 
 // -----------------------------------------------------------------------------
-// HockeyMatch class – core match orchestration
+// ScoreboardRenderer – draws the scoreboard on its own thread
 // -----------------------------------------------------------------------------
-class HockeyMatch {
+// The input thread only publishes a ScoreboardState and asks for a frame; it
+// never waits for the terminal. Frames are capped at max_fps and every request
+// that arrives while a frame is pending is folded into that one frame.
+class ScoreboardRenderer {
     private:
-        Team home_team_;
-        Team away_team_;
-        int current_quarter_ = 1;
-        std::vector<MatchEvent> event_log_; // Chronological list of all events
+        OutputSink& out_;
+        const std::string home_name_;
+        const std::string away_name_;
+        const std::string footer_; // drawn under the scoreboard (the menu)
+        const std::chrono::nanoseconds frame_interval_;
 
-        void addEvent(const std::string& event_description) {
-            event_log_.emplace_back(current_quarter_, event_description); // emplace_back constructs MatchEvent in-place
-        }
+        SeqLock<ScoreboardState> state_;
+        std::atomic<std::uint64_t> requested_{0};
+        std::atomic<bool> paused_{false};
+        bool stop_ = false; // guarded by wake_mutex_
+        std::mutex wake_mutex_;
+        std::condition_variable wake_;
+        std::mutex frame_mutex_; // held while drawing so pause() can wait a frame out
+        std::thread thread_;
 
-        void scoreGoalFor(Team& team, const std::string& scorer = {}) {
-            team.scoreGoal();
-            if (scorer.empty()) {
-                addEvent(team.name() + " goal!");
-            } else {
-                addEvent(team.name() + " goal! (" + scorer + ")");
+        void run() {
+            std::uint64_t drawn = 0;
+            auto next_frame = std::chrono::steady_clock::now();
+            while (true) {
+                {
+                    std::unique_lock lock(wake_mutex_);
+                    wake_.wait(lock, [&] {
+                        return stop_ || (!paused_.load() && requested_.load() != drawn);
+                    });
+                    if (stop_) { return; }
+                }
+                std::this_thread::sleep_until(next_frame); // requests arriving now share this frame
+                drawn = requested_.load();
+
+                std::lock_guard frame(frame_mutex_);
+                if (paused_.load()) { continue; }
+                clearScreen(out_);
+                renderScoreboard(out_, home_name_, away_name_, state_.load());
+                out_.write(footer_);
+                out_.flush();
+                next_frame = std::chrono::steady_clock::now() + frame_interval_;
             }
         }
 
-        void showCardFor(Team& team, CardType type) {
-            team.receiveCard(type);
-            addEvent(std::string(cardName(type)) + " card - " + team.name());
+        void wake() {
+            { std::lock_guard lock(wake_mutex_); } // orders the change before the waiter's predicate check
+            wake_.notify_one();
+        }
 
+    public:
+        ScoreboardRenderer(OutputSink& out, const HockeyMatch& match, std::string footer, int max_fps = 30)
+            :   out_(out),
+                home_name_(match.home().name()),
+                away_name_(match.away().name()),
+                footer_(std::move(footer)),
+                frame_interval_(std::chrono::seconds(1) / std::max(1, max_fps)) {
+            state_.store(match.state());
+            thread_ = std::thread(&ScoreboardRenderer::run, this);
         }
 
-        void awardPenaltyCornerFor(Team& team) {
-            team.awardPenaltyCorner();
-            addEvent("Penalty corner - " + team.name());
+        ScoreboardRenderer(const ScoreboardRenderer&) = delete;
+        ScoreboardRenderer& operator=(const ScoreboardRenderer&) = delete;
+
+        ~ScoreboardRenderer() { stop(); }
+
+        // Called by the input thread after changing the match
+        void publish(const HockeyMatch& match) {
+            state_.store(match.state());
+            requestFrame();
         }
 
+        void requestFrame() {
+            requested_.fetch_add(1);
+            wake();
+        }
 
-    public:
-    // constructor:
-    HockeyMatch(std::string home_name, std::string away_name)
-        :   home_team_(std::move(home_name)),
-            away_team_(std::move(away_name)) {
-            addEvent("=== Start of Q1 ===");
+        // Hands the terminal to the caller (returns once any frame in flight is done)
+        void pause() {
+            paused_.store(true);
+            std::lock_guard frame(frame_mutex_);
         }
 
+        void resume() {
+            paused_.store(false);
+            requestFrame();
+        }
 
-        // --------------------- Const accessors ---------------------
-        const Team& home() const noexcept                            { return home_team_; }
-        const Team& away() const noexcept                           { return away_team_; }
-        int quarter() const noexcept                                 { return current_quarter_; }
-        const std::vector<MatchEvent>& events() const       { return event_log_; }
+        void stop() {
+            {
+                std::lock_guard lock(wake_mutex_);
+                stop_ = true;
+            }
+            wake_.notify_one();
+            if (thread_.joinable()) { thread_.join(); }
+        }
+};
+
+// -----------------------------------------------------------------------------
+// EventLogViewport – shows a window of the event log instead of all of it
+// -----------------------------------------------------------------------------
+// Only the rows on screen are looked at, so drawing costs O(rows) however
+// long the log is. Events never change once logged, so each formatted line is
+// cached. Scrolling back and forth reuses those lines; the cache only keeps
+// lines near the viewport. When following the tail, the window stays on the
+// newest events as the log grows.
+class EventLogViewport {
+    private:
+        static constexpr std::size_t kCacheLines = 4096;
 
+        const EventLog& log_;
+        std::size_t rows_;
+        std::size_t top_ = 0;
+        bool follow_ = true;
+        std::unordered_map<std::size_t, std::string> lines_; // event index -> formatted line
 
-        // --------------------- Game actions ---------------------
-        void goalForHome()  { scoreGoalFor(home_team_); }
-        void goalForAway()  { scoreGoalFor(away_team_); }
+        std::size_t maxTop() const noexcept { return log_.size() > rows_ ? log_.size() - rows_ : 0; }
 
-        void cardForHome(CardType type) { showCardFor(home_team_, type); }
-        void cardForAway(CardType type) { showCardFor(away_team_, type); }
+        const std::string& line(std::size_t index) {
+            auto [it, added] = lines_.try_emplace(index);
+            if (added) {
+                const MatchEvent& event = log_[index];
+                it->second = std::format("Q{} - {}\n", event.quarter(), event.description());
+            }
+            return it->second;
+        }
 
-        void penaltyCornerForHome() { awardPenaltyCornerFor(home_team_); }
-        void penaltyCornerForAway() { awardPenaltyCornerFor(away_team_); }
+        // Drops cached lines far from the viewport once the cache is full
+        void trimCache() {
+            if (lines_.size() <= kCacheLines) { return; }
+            const std::size_t keep_from = top_ > kCacheLines / 2 ? top_ - kCacheLines / 2 : 0;
+            std::erase_if(lines_, [&](const auto& entry) {
+                return entry.first < keep_from || entry.first >= keep_from + kCacheLines;
+            });
+        }
 
-        // Returns false when match is over (after quarter 4)
-        bool nextQuarter() {
-            if (current_quarter_ > TOTAL_QUARTERS) {
-                return false;
+    public:
+        EventLogViewport(const EventLog& log, std::size_t rows) : log_(log), rows_(std::max<std::size_t>(rows, 1)) {}
+
+        std::size_t top() const noexcept { return follow_ ? maxTop() : std::min(top_, maxTop()); }
+        bool following() const noexcept { return follow_; }
+
+        // Positive scrolls towards newer events; reaching the end resumes following
+        void scroll(std::ptrdiff_t lines) {
+            const auto current = static_cast<std::ptrdiff_t>(top());
+            const auto target = std::clamp<std::ptrdiff_t>(current + lines, 0, static_cast<std::ptrdiff_t>(maxTop()));
+            top_ = static_cast<std::size_t>(target);
+            follow_ = top_ == maxTop();
+        }
+
+        void page(int pages) { scroll(static_cast<std::ptrdiff_t>(pages) * static_cast<std::ptrdiff_t>(rows_)); }
+
+        void follow() { follow_ = true; }
+
+        // Scrolls to the first event of the quarter (events are logged in quarter order)
+        void jumpToQuarter(int quarter) {
+            std::size_t low = 0, high = log_.size();
+            while (low < high) {
+                const std::size_t mid = low + (high - low) / 2;
+                if (log_[mid].quarter() < quarter) { low = mid + 1; } else { high = mid; }
             }
-        
-            // Always log the end of the current quarter
-            addEvent("=== End of Q" + std::to_string(current_quarter_) + " ===");
-        
-            if (current_quarter_ < TOTAL_QUARTERS) {
-                ++current_quarter_;
-                addEvent("=== Start of Q" + std::to_string(current_quarter_) + " ===");
-                return true;
+            top_ = std::min(low, maxTop());
+            follow_ = top_ == maxTop();
+        }
+
+        void render(OutputSink& out) {
+            const std::size_t first = top();
+            top_ = first;
+            const std::size_t last = std::min(first + rows_, log_.size());
+            out.write("\n--- Event Log ---\n");
+            if (log_.empty()) {
+                out.write("No events yet.\n");
             }
-        
-            // After Q4 ends, match is over — no start of Q5
-            return false;
+            for (std::size_t i = first; i < last; ++i) { out.write(line(i)); }
+            for (std::size_t i = last - first; i < rows_ && !log_.empty(); ++i) { out.write("\n"); }
+            out.print("-- events {}-{} of {}{} --\n", log_.empty() ? 0 : first + 1, last, log_.size(),
+                      follow_ ? ", following" : "");
+            trimCache();
         }
+};
 
-        // --------------------- Display functions ---------------------
-        void printScoreboard() const {
-            std::cout << "\n=== FIELD HOCKEY SCOREBOARD ===\n";
+#ifndef _WIN32
+// --standby mode: mirror the primary's match until it goes away, then take it over
+static std::optional<HockeyMatch> followPrimary(OutputSink& out, const std::string& address) {
+    ReplicationStandby standby(address);
+    std::uint64_t shown = std::numeric_limits<std::uint64_t>::max();
+    while (standby.connected()) {
+        if (standby.lastApplied() != shown) {
+            shown = standby.lastApplied();
+            clearScreen(out);
+            out.print("STANDBY for {} (record {})\n", address, shown);
+            standby.inspect([&](const std::map<std::uint32_t, HockeyMatch>& matches) {
+                for (const auto& [id, match] : matches) { match.printScoreboard(out); }
+            });
+            out.flush();
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    }
+
+    auto matches = standby.takeOver();
+    out.print("\nPrimary lost{}{} - taking over.\n", standby.error().empty() ? "" : ": ", standby.error());
+    pauseFor(out, std::chrono::seconds(1));
+    if (matches.empty()) { return std::nullopt; }
+    return std::move(matches.begin()->second);
+}
+#endif
+
+// Reads a file written by menu option 10: an NDJSON/CSV archive or a match image
+static ImportResult loadExport(const std::string& path) {
+    {
+        const MappedFile file(path);
+        if (file.view().starts_with("HKMV")) {
+            ImportResult result;
+            HockeyMatch match = MatchView(file.view()).restore();
+            result.records = match.events().size();
+            result.matches.emplace(match.id(), std::move(match));
+            return result;
+        }
+    }
+    return ArchiveImporter::importFile(path);
+}
+
+// Shows the first few lines that could not be loaded; true if there were none
+static bool reportImportErrors(OutputSink& out, const std::string& path, const ImportResult& result) {
+    for (std::size_t i = 0; i < result.errors.size() && i < 10; ++i) {
+        out.print("{}:{}: {}\n", path, result.errors[i].line, result.errors[i].message);
+    }
+    if (result.errors.size() > 10) { out.print("... and {} more errors\n", result.errors.size() - 10); }
+    return result.errors.empty();
+}
+
+// --self-test: drives the parts that only other programs feed (numbered
+// device actions and the like) with known sequences and checks the outcome.
+// Prints one "ok"/"FAIL" line per check; the exit status is 1 if any failed.
+static int runSelfTest(OutputSink& out) {
+    int failures = 0;
+    const auto check = [&](bool passed, std::string_view name) {
+        out.print("{} - {}\n", passed ? "ok" : "FAIL", name);
+        if (!passed) { ++failures; }
+    };
+    const auto kinds = [](const HockeyMatch& match) {
+        std::vector<EventKind> seen;
+        for (const auto& event : match.events()) { seen.push_back(event.kind()); }
+        return seen;
+    };
+
+    {
+        HockeyMatch match("Home", "Away");
+        SequencedIngest ingest(match);
+        const MatchAction home_goal{ActionKind::Goal, Side::Home, CardType::Count, 1'000};
+        const MatchAction away_corner{ActionKind::PenaltyCorner, Side::Away, CardType::Count, 2'000};
+        const MatchAction away_goal{ActionKind::Goal, Side::Away, CardType::Count, 5'000};
+        const MatchAction home_card{ActionKind::Card, Side::Home, CardType::Green, 6'000, 4};
+        using Result = SequencedIngest::Result;
+
+        check(ingest.offer(2, away_corner) == Result::Buffered && match.events().size() == 1,
+              "sequenced ingest holds an action that arrives early");
+        check(ingest.offer(1, home_goal) == Result::Released && ingest.next() == 3,
+              "sequenced ingest releases the held action once the gap fills");
+        check(ingest.offer(2, away_corner) == Result::Duplicate && ingest.duplicates() == 1,
+              "sequenced ingest drops a repeat");
+        check(ingest.offer(5, away_goal) == Result::Buffered && ingest.held() == 1, "sequenced ingest waits at a gap");
+        ingest.flush();
+        check(ingest.next() == 6 && ingest.skipped() == 2 && ingest.held() == 0,
+              "sequenced ingest skips the gap on flush");
+        check(ingest.offer(3, home_goal) == Result::Late && ingest.late() == 1,
+              "sequenced ingest refuses an action whose gap was given up");
+        check(ingest.assign(home_card) == 6, "sequenced ingest numbers a local action after the rest");
+        check(kinds(match) == std::vector{EventKind::QuarterStart, EventKind::Goal, EventKind::PenaltyCorner,
+                                          EventKind::Goal, EventKind::Card} &&
+              match.home().goals() == 1 && match.away().goals() == 1 && match.events().back().player() == 4,
+              "sequenced ingest applies each action once, in number order");
+    }
+
+    {
+        DisciplineTracker discipline;
+        HockeyMatch played("Home", "Away", 1);
+        played.cardForHome(CardType::Red, 7);
+        for (int i = 0; i < 3; ++i) { played.cardForHome(CardType::Yellow, 9); }
+        played.cardForHome(CardType::Yellow, 10);
+        discipline.add(MatchRecord::from({2000, 0, 1}, played));
+        check(discipline.matchesBanned("Home", 7) == 1 && discipline.matchesBanned("Home", 9) == 1 &&
+              discipline.matchesBanned("Home", 10) == 0,
+              "discipline counts the cards of a stored match");
+
+        HockeyMatch match("Away", "Home", 2);
+        discipline.attach(match);
+        check(!discipline.eligible("Home", 7, 2) && !discipline.eligible("Home", 9, 2) &&
+              discipline.eligible("Home", 10, 2),
+              "discipline bans a red card and a third yellow from the team's next match");
+        for (int i = 0; i < 4; ++i) { match.cardForAway(CardType::Green, 11); } // "Home" plays away here
+        check(discipline.matchesBanned("Home", 11) == 0, "discipline lets four greens go");
+        match.cardForAway(CardType::Green, 11);
+        match.cardForHome(CardType::Red, 3);
+        check(discipline.matchesBanned("Home", 11) == 1 && discipline.matchesBanned("Away", 3) == 1 &&
+              discipline.matchesBanned("Home", 7) == 0,
+              "discipline follows the cards of an attached match");
+        discipline.detach(match);
+        discipline.schedule(3, "Home", "Away");
+        check(!discipline.eligible("Home", 11, 3) && discipline.eligible("Home", 7, 3),
+              "discipline serves a ban in the next fixture only");
+    }
 
-            std::cout << std::format("{:<20} {} - {} {:<20}\n",
-                home_team_.name(), home_team_.goals(),
-                away_team_.goals(), away_team_.name());
+    out.print("{}\n", failures == 0 ? "All checks passed." : std::format("{} check(s) failed.", failures));
+    return failures == 0 ? 0 : 1;
+}
 
-            std::cout << std::format("Quarter: {}/4\n\n", current_quarter_);
+int main(int argc, char* argv[]) {
+    FdSink console(1); // stdout; flushed before every read from std::cin
 
-            std::cout << "Cards & PCs:\n";
-            std::cout << std::format("{:<20} {}\n", home_team_.name(), home_team_.statsLine());
-            std::cout << std::format("{:<20} {}\n", away_team_.name(), away_team_.statsLine());
-            std::cout << "================================\n\n";
+    // Command line:
+    //   --shm NAME         publish the live match to shared memory
+    //   --replicate ADDR   act as primary, streaming events to standbys on ADDR
+    //   --standby ADDR     follow the primary on ADDR and take over if it dies
+    //   --season-db DIR    store the match in the season database in DIR when it ends
+    //   --journal FILE     log every event durably to FILE; an unfinished match there is resumed
+    //   --import FILE      store the matches of an exported NDJSON/CSV archive or match image
+    //                      in the season database (needs --season-db) and exit
+    //   --merge FILE       one scorer's export of a match; given twice or more, the exports are
+    //                      merged into one match in the season database (needs --season-db)
+    //   --self-test        run the built-in checks and exit
+    // ADDR is unix:/path or host:port
+    std::string shm_name, replicate_address, standby_address, season_dir, journal_path, import_path;
+    std::vector<std::string> merge_paths;
+    for (int i = 1; i < argc; ++i) {
+        const std::string_view arg = argv[i];
+        if (arg == "--shm" && i + 1 < argc) {
+            shm_name = argv[++i];
+        } else if (arg == "--replicate" && i + 1 < argc) {
+            replicate_address = argv[++i];
+        } else if (arg == "--standby" && i + 1 < argc) {
+            standby_address = argv[++i];
+        } else if (arg == "--season-db" && i + 1 < argc) {
+            season_dir = argv[++i];
+        } else if (arg == "--journal" && i + 1 < argc) {
+            journal_path = argv[++i];
+        } else if (arg == "--import" && i + 1 < argc) {
+            import_path = argv[++i];
+        } else if (arg == "--merge" && i + 1 < argc) {
+            merge_paths.emplace_back(argv[++i]);
+        } else if (arg == "--self-test") {
+            return runSelfTest(console);
+        } else {
+            console.print("Unknown option: {}\nUsage: {} [--shm NAME] [--replicate ADDR | --standby ADDR] "
+                          "[--season-db DIR] [--journal FILE] [--import FILE] [--merge FILE]... [--self-test]\n",
+                          arg, argv[0]);
+            return 1;
         }
+    }
 
+    // Matches are stored under the current year, competition 0
+    const std::chrono::year_month_day today{std::chrono::floor<std::chrono::days>(std::chrono::system_clock::now())};
+    const auto season = static_cast<std::uint16_t>(static_cast<int>(today.year()));
+    const SeasonKey season_first{season, 0, 0}, season_last{season, 0, std::numeric_limits<std::uint32_t>::max()};
 
-        void printEventLog() const {
-            std::cout << "\n--- Event Log ---\n";
-            if (event_log_.empty()) {
-                std::cout << "No events yet.\n";
-            } else {
-                for (const auto& event : event_log_) {
-                    std::cout << event.toString() << "\n";
+    if (!import_path.empty()) {
+        if (season_dir.empty()) {
+            console.write("--import needs --season-db DIR to store the matches in.\n");
+            return 1;
+        }
+        try {
+            SeasonStore store(season_dir);
+            const auto stored = store.range(season_first, season_last);
+            std::uint32_t next_id = stored.empty() ? 1 : stored.back().key.match_id + 1;
+            const ImportResult result = loadExport(import_path);
+            const bool clean = reportImportErrors(console, import_path, result);
+            // Archive ids are renumbered after the season's matches, keeping their order
+            for (const auto& [id, imported] : result.matches) {
+                store.put(MatchRecord::from({season, 0, next_id++}, imported));
+            }
+            store.flush();
+            console.print("Imported {} matches ({} records) into {}\n", result.matches.size(), result.records,
+                          season_dir);
+            return clean ? 0 : 1;
+        } catch (const std::exception& e) {
+            console.print("Import failed: {}\n", e.what());
+            return 1;
+        }
+    }
+
+    // Each file is one scorer device's record of the same match. Events are
+    // ordered by match time; an action two devices recorded within 3 s of
+    // each other is kept once.
+    if (!merge_paths.empty()) {
+        if (season_dir.empty() || merge_paths.size() < 2) {
+            console.write("--merge needs --season-db DIR and at least two files.\n");
+            return 1;
+        }
+        try {
+            SeasonStore store(season_dir);
+            const auto stored = store.range(season_first, season_last);
+            const std::uint32_t match_id = stored.empty() ? 1 : stored.back().key.match_id + 1;
+            std::optional<ReplicatedEventLog> merged;
+            std::size_t actions = 0;
+            bool clean = true;
+            for (std::uint32_t device = 1; device <= merge_paths.size(); ++device) {
+                const std::string& path = merge_paths[device - 1];
+                const ImportResult result = loadExport(path);
+                clean = reportImportErrors(console, path, result) && clean;
+                if (result.matches.size() != 1) {
+                    throw std::runtime_error(std::format("{} holds {} matches, not one", path, result.matches.size()));
+                }
+                const HockeyMatch& scored = result.matches.begin()->second;
+                if (!merged) {
+                    merged.emplace(0, scored.home().name(), scored.away().name(), match_id);
+                } else if (scored.home().name() != merged->match().home().name() ||
+                           scored.away().name() != merged->match().away().name()) {
+                    throw std::runtime_error(path + " is a different match");
                 }
+                std::vector<DeviceEvent> events;
+                std::uint32_t counter = 0;
+                for (const auto& event : scored.events()) {
+                    const auto action = replayAction(static_cast<std::uint8_t>(event.kind()),
+                                                     static_cast<std::uint8_t>(event.side()),
+                                                     static_cast<std::uint8_t>(event.card()), event.clockMs(),
+                                                     event.player());
+                    if (action) { events.push_back({std::uint64_t{event.clockMs()} << 16, device, counter++, *action}); }
+                }
+                actions += events.size();
+                merged->merge(events);
             }
-            std::cout << "-----------------\n\n";
+            store.put(MatchRecord::from({season, 0, match_id}, merged->match()));
+            store.flush();
+            console.print("Merged {} actions from {} files into match {} ({} events) in {}\n", actions,
+                          merge_paths.size(), match_id, merged->match().events().size(), season_dir);
+            return clean ? 0 : 1;
+        } catch (const std::exception& e) {
+            console.print("Merge failed: {}\n", e.what());
+            return 1;
         }
-};
+    }
 
-// display things
-static void clearScreen() {
-    #ifdef _WIN32
-        std::system("cls");
+    std::optional<HockeyMatch> replicated;
+    if (!standby_address.empty()) {
+    #ifndef _WIN32
+        try {
+            replicated = followPrimary(console, standby_address);
+        } catch (const std::exception& e) {
+            console.print("Standby failed: {}\n", e.what());
+            return 1;
+        }
     #else
-        std::cout << "\x1B[2J\x1B[H" << std::flush;
+        console.write("Replication is not available on Windows.\n");
     #endif
     }
+    // The journal only ever holds the match being played: anything else in it
+    // is kept aside, never mixed with the new match or deleted
+    bool resumed = false;
+    if (!journal_path.empty() && std::filesystem::exists(journal_path)) {
+        // Renames the journal to the first free FILE.suffix[.N]; if that fails
+        // the journal is switched off rather than overwritten
+        const auto moveAside = [&](const char* suffix) {
+            std::string aside = journal_path + suffix;
+            for (int n = 1; std::filesystem::exists(aside); ++n) {
+                aside = journal_path + suffix + "." + std::to_string(n);
+            }
+            std::error_code error;
+            std::filesystem::rename(journal_path, aside, error);
+            if (error) {
+                aside = "nowhere (" + error.message() + "), journal disabled";
+                journal_path.clear();
+            }
+            return aside;
+        };
+        try {
+            auto journaled = MatchJournal::replay(journal_path);
+            const bool unfinished = !journaled.empty() && !journaled.begin()->second.finished();
+            std::error_code error;
+            if (unfinished && !replicated) {
+                replicated = std::move(journaled.begin()->second);
+                resumed = true;
+                console.write("Resuming the unfinished match from the journal.\n");
+            } else if (unfinished) {
+                console.print("Unfinished match in the journal moved to {}.\n", moveAside(".prev"));
+            } else if (std::filesystem::file_size(journal_path, error) > 0 || error) {
+                console.print("{} in the journal moved to {}.\n", journaled.empty() ? "Old journal" : "Finished match",
+                              moveAside(".done"));
+            }
+        } catch (const std::exception& e) {
+            console.print("Journal unreadable ({}), moved to {}; starting a new match.\n", e.what(), moveAside(".corrupt"));
+        }
+    }
 
-int main() {
-    std::cout << "🏑 Welcome to Field Hockey Scoreboard Simulator 🏑\n\n";
+    console.write("🏑 Welcome to Field Hockey Scoreboard Simulator 🏑\n\n");
 
     std::string home_name;
     std::string away_name;
 
-    std::cout << "Enter home team: ";
-    std::getline(std::cin, home_name);
-    std::cout << "Enter away team: ";
-    std::getline(std::cin, away_name);
+    if (!replicated) {
+        console.write("Enter home team: ");
+        console.flush();
+        std::getline(std::cin, home_name);
+        console.write("Enter away team: ");
+        console.flush();
+        std::getline(std::cin, away_name);
+    }
 
     if (home_name.empty()) { home_name = "Home"; }
     if (away_name.empty()) { away_name = "Away"; }
 
-    HockeyMatch match(std::move(home_name), std::move(away_name));
+#ifndef _WIN32
+    // Declared first so they outlive the match they observe
+    std::unique_ptr<SharedScoreboard> shared_board;
+    std::unique_ptr<ReplicationPrimary> primary;
+#endif
+    std::unique_ptr<SeasonStore> season_store;
+    std::unique_ptr<MatchJournal> journal;
+    DisciplineTracker discipline;
+    EventBus bus;
+    EventIndex index; // the season's events and this match's, for searching
+    MatchArchive archive; // the season's stored matches, compressed, for showing search hits
+    ConversionTable conversion;
+    std::vector<std::string> notices; // from bus subscribers, shown after the action that caused them
+
+    // The season's stored matches give a new match its id and carry suspensions over
+    std::vector<MatchRecord> season_matches;
+    if (!season_dir.empty()) {
+        try {
+            season_store = std::make_unique<SeasonStore>(season_dir);
+            season_matches = season_store->range(season_first, season_last);
+        } catch (const std::exception& e) {
+            season_store.reset();
+            console.print("Season database disabled: {}\n", e.what());
+            pauseFor(console, std::chrono::seconds(1));
+        }
+    }
+    const std::uint32_t match_id = season_matches.empty() ? 1 : season_matches.back().key.match_id + 1;
+    HockeyMatch match = replicated ? std::move(*replicated)
+                                   : HockeyMatch(std::move(home_name), std::move(away_name), match_id);
+    for (const auto& record : season_matches) {
+        if (record.key.match_id == match.id()) { continue; } // a resumed match that was stored unfinished
+        discipline.add(record);
+        index.add(record);
+        archive.retire(record);
+        conversion.add(record);
+    }
+    conversion.attach(match, season);
+    std::vector<MatchRecord>().swap(season_matches);
+    index.attach(match, {season, 0, match.id()});
+    discipline.attach(match); // before the bus, so a card's ban is counted when its subscribers run
+    EventFilter cards;
+    cards.kinds = {EventKind::Card};
+    bus.subscribe(cards, [&](const HockeyMatch& carded, const MatchEvent& event) {
+        if (event.player() == 0) { return; }
+        const std::string& team = event.side() == Side::Home ? carded.home().name() : carded.away().name();
+        if (const int banned = discipline.matchesBanned(team, event.player()); banned > 0) {
+            notices.push_back(std::format("{} #{} is suspended for the next {} match{}.", team, event.player(), banned,
+                                          banned == 1 ? "" : "es"));
+        }
+    });
+    bus.attach(match);
+    // Alerts for the scorer: a run of corners, a team's second yellow in a quarter, two goals made up
+    const PatternStep corner{EventKind::PenaltyCorner, {}, PatternSide::Subject, {}, {}};
+    const PatternStep yellow{EventKind::Card, CardType::Yellow, PatternSide::Subject, {}, {}};
+    const PatternSpec comeback{"comeback from two goals down",
+                               {{EventKind::Goal, {}, PatternSide::Opponent, {}, -2},
+                                {EventKind::Goal, {}, PatternSide::Subject, 0, {}}}};
+    PatternEngine alerts({PatternSpec::repeated("penalty corner burst", corner, 3, 120'000),
+                          PatternSpec::repeated("second yellow card this quarter", yellow, 2, 0, true), comeback},
+                         [&](const PatternAlert& alert) {
+                             const std::string& name = alerts.patterns()[alert.pattern].name;
+                             if (alert.side == Side::None) {
+                                 notices.push_back("Alert: " + name);
+                             } else {
+                                 notices.push_back(std::format("Alert: {} for {}", name, alert.side == Side::Home
+                                                               ? match.home().name() : match.away().name()));
+                             }
+                         });
+    alerts.attach(match);
+    WindowAnalytics windows({WindowSpec::sliding(EventKind::Goal, 600'000, 10'000),
+                             WindowSpec::sliding(EventKind::PenaltyCorner, 300'000, 10'000),
+                             WindowSpec::tumbling(EventKind::Card, 300'000)});
+    const std::array<const char*, 3> window_names{"Goals, last 10 min", "Penalty corners, last 5 min",
+                                                  "Cards, this 5-min block"};
+    windows.attach(match);
+    if (!shm_name.empty()) {
+    #ifndef _WIN32
+        shared_board = std::make_unique<SharedScoreboard>(shm_name, 1);
+        shared_board->attach(match);
+    #else
+        console.write("Shared memory publishing is not available on Windows.\n");
+    #endif
+    }
+    if (!replicate_address.empty()) {
+    #ifndef _WIN32
+        try {
+            primary = std::make_unique<ReplicationPrimary>(replicate_address);
+            primary->attach(match);
+        } catch (const std::exception& e) {
+            console.print("Replication disabled: {}\n", e.what());
+            pauseFor(console, std::chrono::seconds(1));
+        }
+    #else
+        console.write("Replication is not available on Windows.\n");
+    #endif
+    }
+    if (!journal_path.empty()) {
+        try {
+            journal = std::make_unique<MatchJournal>(journal_path, true, !resumed); // a new match gets a fresh journal
+            journal->attach(match);
+        } catch (const std::exception& e) {
+            console.print("Journal disabled: {}\n", e.what());
+            pauseFor(console, std::chrono::seconds(1));
+        }
+    }
+    if (season_store) { season_store->attach(match, season, 0); }
+
+    // The scoreboard and menu are drawn by the render thread; this thread
+    // only reads input, changes the match and publishes the new state. Both
+    // write to stdout, so the renderer is paused from the moment a choice is
+    // read until the action's prompts and messages are done.
+    FdSink screen(1);
+    std::string suspended; // players the season's earlier cards keep out of this match
+    for (const Team* team : {&match.home(), &match.away()}) {
+        for (unsigned number = 1; number < DisciplineTracker::kPlayersPerTeam; ++number) {
+            if (!discipline.eligible(team->name(), static_cast<std::uint8_t>(number), match.id())) {
+                suspended += std::format("{}{} #{}", suspended.empty() ? "Suspended: " : ", ", team->name(), number);
+            }
+        }
+    }
+    if (!suspended.empty()) { suspended += "\n\n"; }
+    ScoreboardRenderer renderer(screen, match,
+        suspended +
+        std::format("Actions:\n"
+                    "1. Goal {}\n"
+                    "2. Goal {}\n"
+                    "3. Green card\n"
+                    "4. Yellow card\n"
+                    "5. Red card\n"
+                    "6. Penalty corner\n"
+                    "7. Next quarter\n"
+                    "8. Show event log\n"
+                    "9. Quit match early\n"
+                    "10. Export event log\n"
+                    "11. Latency stats\n"
+                    "12. Dump trace\n"
+                    "13. Match stats\n"
+                    "14. Search events\n"
+                    "Choice: ", match.home().name(), match.away().name()));
 
     bool match_in_progress = true;
 
     while (match_in_progress && match.quarter() <= TOTAL_QUARTERS) {
-        clearScreen();
-        match.printScoreboard();
-
-        std::cout << "Actions:\n"
-                  << "1. Goal " << match.home().name() << "\n"
-                  << "2. Goal " << match.away().name() << "\n"
-                  << "3. Green card\n"
-                  << "4. Yellow card\n"
-                  << "5. Red card\n"
-                  << "6. Penalty corner\n"
-                  << "7. Next quarter\n"
-                  << "8. Show event log\n"
-                  << "9. Quit match early\n"
-                  << "Choice: ";
+        console.flush();
+        renderer.publish(match);
+        renderer.resume();
 
         int choice = 0;
-        if (!(std::cin >> choice)) {
+        bool parsed = false;
+        {
+            HOCKEY_TRACE("main.readChoice");
+            parsed = static_cast<bool>(std::cin >> choice);
+        }
+        renderer.pause();
+        if (!parsed) {
             std::cin.clear();
             ignoreLine();
-            std::cout << "Invalid input. Please enter a number.\n";
-            std::this_thread::sleep_for(std::chrono::seconds(1));
+            console.write("Invalid input. Please enter a number.\n");
+            pauseFor(console, std::chrono::seconds(1));
             continue;
         }
         ignoreLine();
@@ -274,8 +6715,8 @@ int main() {
                 match.goalForAway(); break;
             case 3: case 4: case 5: {
                 char side;
-                std::cout << "For which team? (h = " << match.home().name()
-                          << ", a = " << match.away().name() << "): ";
+                console.print("For which team? (h = {}, a = {}): ", match.home().name(), match.away().name());
+                console.flush();
                 std::cin >> side;
                 ignoreLine();
 
@@ -283,19 +6724,33 @@ int main() {
                                     : (choice == 4) ? CardType::Yellow
                                                     : CardType::Red;
 
+                if (side != 'h' && side != 'H' && side != 'a' && side != 'A') {
+                    console.write("Invalid team choice.\n");
+                    pauseFor(console, std::chrono::milliseconds(800));
+                    break;
+                }
+
+                // Optional - the discipline tracker needs it to count cards per player and suspend
+                console.write("Player number (1-99, Enter to skip): ");
+                console.flush();
+                std::string number_text;
+                std::getline(std::cin, number_text);
+                unsigned player = 0;
+                std::from_chars(number_text.data(), number_text.data() + number_text.size(), player);
+                if (player > 99) { player = 0; }
+
                 if (side == 'h' || side == 'H')
-                    match.cardForHome(type);
-                else if (side == 'a' || side == 'A')
-                    match.cardForAway(type);
+                    match.cardForHome(type, static_cast<std::uint8_t>(player));
                 else
-                    std::cout << "Invalid team choice.\n";
+                    match.cardForAway(type, static_cast<std::uint8_t>(player));
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(800));
+                pauseFor(console, std::chrono::milliseconds(800));
                 break;
             }
             case 6: {
                 char side = '\0';
-                std::cout << "For which team? (h/a): ";
+                console.write("For which team? (h/a): ");
+                console.flush();
                 std::cin >> side;
                 ignoreLine();
 
@@ -304,9 +6759,9 @@ int main() {
                 else if (side == 'a' || side == 'A')
                     match.penaltyCornerForAway();
                 else
-                    std::cout << "Invalid team choice.\n";
+                    console.write("Invalid team choice.\n");
 
-                std::this_thread::sleep_for(std::chrono::milliseconds(800));
+                pauseFor(console, std::chrono::milliseconds(800));
                 break;
             }
             case 7:
@@ -314,29 +6769,189 @@ int main() {
                     match_in_progress = false;
                 }
                 break;
-            case 8:
-                clearScreen();
-                match.printEventLog();
-                std::cout << "Press Enter to return to scoreboard...";
-                std::cin.get();
+            case 8: {
+                EventLogViewport view(match.events(), 20);
+                std::string command;
+                do {
+                    clearScreen(console);
+                    view.render(console);
+                    console.write("[n]ext / [p]revious page, [+]/[-] line, [q1-4] jump to quarter, "
+                                  "[e]nd, Enter to return: ");
+                    console.flush();
+                    if (!std::getline(std::cin, command)) { break; }
+                    if (command == "n")       { view.page(1); }
+                    else if (command == "p")  { view.page(-1); }
+                    else if (command == "+")  { view.scroll(1); }
+                    else if (command == "-")  { view.scroll(-1); }
+                    else if (command == "e")  { view.follow(); }
+                    else if (command.size() == 2 && command[0] == 'q' && command[1] >= '1' && command[1] <= '4') {
+                        view.jumpToQuarter(command[1] - '0');
+                    }
+                } while (!command.empty());
                 break;
+            }
             case 9:
-                std::cout << "Ending match early...\n";
-                std::this_thread::sleep_for(std::chrono::seconds(1));
+                console.write("Ending match early...\n");
+                pauseFor(console, std::chrono::seconds(1));
                 match_in_progress = false;
                 break;
+            case 10: {
+                char format = '\0';
+                std::string path;
+                console.write("Format? (n = NDJSON, c = CSV, b = binary match image): ");
+                console.flush();
+                std::cin >> format;
+                ignoreLine();
+                console.write("File name: ");
+                console.flush();
+                std::getline(std::cin, path);
+
+                try {
+                    const int fd = openForWrite(path);
+                    const HockeyMatch* exported[] = {&match};
+                    try {
+                        if (format == 'b' || format == 'B') {
+                            std::string image;
+                            MatchView::encode(image, match);
+                            writeAll(fd, image);
+                        } else {
+                            ParallelExporter::write(fd, exported, (format == 'c' || format == 'C') ? ExportFormat::Csv
+                                                                                                  : ExportFormat::Ndjson);
+                        }
+                    } catch (...) {
+                        ::close(fd);
+                        throw;
+                    }
+                    ::close(fd);
+                    console.print("Exported {} events to {}\n", match.events().size(), path);
+                } catch (const std::exception& e) {
+                    console.print("Export failed: {}\n", e.what());
+                }
+                pauseFor(console, std::chrono::seconds(1));
+                break;
+            }
+            case 11:
+            #ifdef HOCKEY_METRICS
+                clearScreen(console);
+                console.write(latencyReport());
+                try {
+                    writeLatencyStatsFile("hockey_stats.json");
+                    console.write("Also written to hockey_stats.json\n");
+                } catch (const std::exception& e) {
+                    console.print("Stats file failed: {}\n", e.what());
+                }
+                console.write("Press Enter to return to scoreboard...");
+                console.flush();
+                std::cin.get();
+            #else
+                console.write("Latency metrics are disabled (build with -DHOCKEY_METRICS).\n");
+                pauseFor(console, std::chrono::seconds(1));
+            #endif
+                break;
+            case 12:
+                try {
+                    TraceRecorder::instance().writeChromeTrace("hockey_trace.json");
+                    console.write("Trace written to hockey_trace.json (open in ui.perfetto.dev)\n");
+                } catch (const std::exception& e) {
+                    console.print("Trace dump failed: {}\n", e.what());
+                }
+                pauseFor(console, std::chrono::seconds(1));
+                break;
+            case 13: {
+                clearScreen(console);
+                const std::uint32_t now = match.clockMs();
+                console.print("{:<30}{:>12}{:>12}\n", "", match.home().name(), match.away().name());
+                for (std::size_t i = 0; i < window_names.size(); ++i) {
+                    console.print("{:<30}{:>12}{:>12}\n", window_names[i], windows.count(match.id(), i, Side::Home, now),
+                                  windows.count(match.id(), i, Side::Away, now));
+                }
+                // This match's corners count as they happen, next to the season's stored matches
+                console.print("\nPenalty corner conversion, {} season\n", season);
+                for (const auto& [team, totals] : conversion.ranking(season)) {
+                    console.print("{:<30}{:>5} of {:<5}{:>6.1f}%\n", team, totals.goals, totals.corners,
+                                  100.0 * totals.rate());
+                }
+                console.write("\nPress Enter to return to scoreboard...");
+                console.flush();
+                std::cin.get();
+                break;
+            }
+            case 14: {
+                EventQuery query;
+                std::string answer;
+                console.write("Team (Enter = any): ");
+                console.flush();
+                std::getline(std::cin, answer);
+                if (!answer.empty()) { query.team = answer; }
+                console.write("Kind? (g = goal, c = card, p = penalty corner, Enter = any): ");
+                console.flush();
+                std::getline(std::cin, answer);
+                if (answer == "g")      { query.kind = EventKind::Goal; }
+                else if (answer == "c") { query.kind = EventKind::Card; }
+                else if (answer == "p") { query.kind = EventKind::PenaltyCorner; }
+                console.write("Quarter (1-4, Enter = any): ");
+                console.flush();
+                std::getline(std::cin, answer);
+                if (answer.size() == 1 && answer[0] >= '1' && answer[0] <= '4') { query.quarter = answer[0] - '0'; }
+
+                // Hits are in the order they were indexed: the season's matches, then this one
+                constexpr std::size_t kShown = 20;
+                const auto hits = index.find(query);
+                clearScreen(console);
+                console.print("{} events found{}\n\n", hits.size(), hits.size() > kShown ? ", latest shown" : "");
+                for (std::size_t i = hits.size() > kShown ? hits.size() - kShown : 0; i < hits.size(); ++i) {
+                    const EventHit& hit = hits[i];
+                    if (hit.match.match_id == match.id()) {
+                        console.print("Match {} ({} v {}) Q{} - {}\n", match.id(), match.home().name(),
+                                      match.away().name(), match.events()[hit.position].quarter(),
+                                      match.events()[hit.position].description());
+                        continue;
+                    }
+                    const auto record = archive.get(hit.match);
+                    const MatchEvent& event = record->events[hit.position];
+                    console.print("Match {} ({} v {}) Q{} - {}\n", hit.match.match_id, record->home_name,
+                                  record->away_name, event.quarter(), event.description());
+                }
+                console.write("\nPress Enter to return to scoreboard...");
+                console.flush();
+                std::cin.get();
+                break;
+            }
             default:
-                std::cout << "Invalid choice. Please try again.\n";
-                std::this_thread::sleep_for(std::chrono::seconds(1));
+                console.write("Invalid choice. Please try again.\n");
+                pauseFor(console, std::chrono::seconds(1));
                 break;
         }
+        if (!notices.empty()) {
+            for (const auto& notice : notices) { console.print("{}\n", notice); }
+            notices.clear();
+            pauseFor(console, std::chrono::milliseconds(1500));
+        }
     }
 
-clearScreen();
-std::cout << "\n=== FINAL RESULT ===\n";
-match.printScoreboard();
-match.printEventLog();
-std::cout << "Match ended. Thank you for using the Field Hockey Scoreboard Simulator!\n\n";
+renderer.stop();
+clearScreen(console);
+console.write("\n=== FINAL RESULT ===\n");
+match.printScoreboard(console);
+match.printEventLog(console);
+for (const Team* team : {&match.home(), &match.away()}) {
+    for (unsigned number = 1; number < DisciplineTracker::kPlayersPerTeam; ++number) {
+        if (const int banned = discipline.matchesBanned(team->name(), static_cast<std::uint8_t>(number)); banned > 0) {
+            console.print("{} #{} is suspended for the next {} match{}.\n", team->name(), number, banned,
+                          banned == 1 ? "" : "es");
+        }
+    }
+}
+if (season_store) {
+    const std::string error = season_store->error();
+    if (!error.empty()) {
+        console.print("Season database: {}\n", error);
+    } else if (match.finished()) {
+        console.print("Match stored in {}\n", season_dir);
+    }
+}
+console.write("Match ended. Thank you for using the Field Hockey Scoreboard Simulator!\n\n");
+console.flush();
 
 return 0;
 }
\ No newline at end of file